@@ -0,0 +1,131 @@
+// Benchmark: bounding volume hierarchy over the cube scene.
+//   - build time with all hardware threads and with one
+//   - refit time
+//   - frustum cull time of the BVH against testing every bounding sphere
+// Usage: bench_bvh [N...]   (defaults to 10k, 1M and 10M cubes)
+// CPU only, no GL context needed.
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bvh.h"
+#include "constants.h"
+#include "frustum.h"
+#include "scene.h"
+
+namespace {
+
+// Camera poses the cull timings are averaged over
+const int kViews = 16;
+const int kCullRepeats = 5;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Views flying around and through the field, looking at its center
+std::vector<Frustum> makeViews(const CubeScene& scene) {
+  std::vector<Frustum> views;
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), constants::ASPECT_RATIO,
+                       constants::NEAR, constants::FAR);
+  glm::vec3 center = scene.center();
+  for (int i = 0; i < kViews; i++) {
+    float angle = 6.2831853f * i / kViews;
+    float radius = scene.field * (i % 2 ? 0.25f : 0.75f);
+    glm::vec3 eye = center + glm::vec3(radius * std::sin(angle),
+                                       0.3f * radius * std::sin(0.5f * angle),
+                                       radius * std::cos(angle));
+    views.push_back(frustumFromMatrix(
+        projection * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f))));
+  }
+  return views;
+}
+
+void run(int n_cubes) {
+  const CubeScene scene = makeCubeScene(n_cubes);
+  std::vector<Aabb> bounds;
+  sphereBounds(scene.x.data(), scene.y.data(), scene.z.data(), CUBE_RADIUS,
+               n_cubes, bounds);
+
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  Bvh bvh;
+  auto start = std::chrono::steady_clock::now();
+  bvh.build(bounds.data(), n_cubes, 1);
+  double build_single_ms = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  bvh.build(bounds.data(), n_cubes, threads);
+  double build_parallel_ms = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  bvh.refit(bounds.data());
+  double refit_ms = millisecondsSince(start);
+
+  std::vector<Frustum> views = makeViews(scene);
+  std::vector<int> visible;
+  visible.reserve(n_cubes);
+  double linear_ms = 0.0, bvh_ms = 0.0;
+  long long visible_total = 0, nodes_tested = 0;
+  bool mismatch = false;
+  for (int repeat = 0; repeat < kCullRepeats; repeat++) {
+    for (const Frustum& frustum : views) {
+      visible.clear();
+      start = std::chrono::steady_clock::now();
+      CullStats linear = cullSpheres(frustum, scene.x.data(), scene.y.data(),
+                                     scene.z.data(), CUBE_RADIUS, n_cubes,
+                                     visible);
+      linear_ms += millisecondsSince(start);
+
+      visible.clear();
+      BvhCullStats bvh_stats;
+      start = std::chrono::steady_clock::now();
+      CullStats hierarchical = bvh.cull(frustum, visible, &bvh_stats);
+      bvh_ms += millisecondsSince(start);
+
+      // boxes are looser than spheres, so the BVH may keep a few more
+      if (hierarchical.visible < linear.visible) {
+        mismatch = true;
+      }
+      visible_total += hierarchical.visible;
+      nodes_tested += bvh_stats.nodes_tested;
+    }
+  }
+  const int culls = kViews * kCullRepeats;
+
+  std::cout << n_cubes << " cubes, " << bvh.nodes().size() << " nodes\n"
+            << "  build   " << build_parallel_ms << " ms (" << threads
+            << " threads), " << build_single_ms << " ms (1 thread)\n"
+            << "  refit   " << refit_ms << " ms\n"
+            << "  cull    " << bvh_ms / culls << " ms bvh, "
+            << linear_ms / culls << " ms per-sphere, "
+            << visible_total / culls << " visible, " << nodes_tested / culls
+            << " nodes tested\n";
+  if (mismatch) {
+    std::cout << "  ERROR: the BVH dropped cubes the sphere test kept\n";
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<int> sizes;
+  for (int i = 1; i < argc; i++) {
+    int n = std::atoi(argv[i]);
+    if (n > 0) {
+      sizes.push_back(n);
+    }
+  }
+  if (sizes.empty()) {
+    sizes = {10000, 1000000, 10000000};
+  }
+  for (int n : sizes) {
+    run(n);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// Benchmark: the per-frame cube update spread over the job system.
+//   - frustum culling, then model matrices written into a separate
+//     instance buffer as the renderer does into mapped GPU memory
+//   - time per frame with 1, 2, 4... threads up to every hardware thread,
+//     and the speedup over one
+//   - results checked against the single-threaded update; exits with 1 on
+//     any mismatch
+// Usage: bench_jobs [N...]   (defaults to 1M cubes)
+// CPU only, no GL context needed: the instance buffer is plain memory.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "constants.h"
+#include "frustum.h"
+#include "job_system.h"
+#include "scene.h"
+#include "transforms.h"
+
+namespace {
+
+const int kFrames = 20;
+const int kGrain = 1024;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Where the benchmark camera starts, looking at the center of the field
+Frustum makeView(const CubeScene& scene) {
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), constants::ASPECT_RATIO,
+                       constants::NEAR, constants::FAR);
+  glm::vec3 center = scene.center();
+  glm::vec3 eye = center + glm::vec3(0.0f, 0.0f, 0.75f * scene.field + 3.0f);
+  return frustumFromMatrix(
+      projection * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
+struct Frame {
+  double cull_ms = 0.0;
+  double transform_ms = 0.0;
+};
+
+// Culls and writes the survivors' matrices to |instances|, as one frame
+Frame update(JobSystem& jobs,
+             const CubeScene& scene,
+             const Frustum& frustum,
+             float time,
+             std::vector<int>& visible,
+             glm::mat4* instances) {
+  Frame frame;
+  auto start = std::chrono::steady_clock::now();
+  visible.clear();
+  cullSpheres(jobs, frustum, scene.x.data(), scene.y.data(), scene.z.data(),
+              CUBE_RADIUS, scene.size(), visible);
+  frame.cull_ms = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  jobs.parallelFor(0, (int)visible.size(), kGrain, [&](int begin, int end) {
+    composeModelMatrices(scene, visible.data() + begin, end - begin, time,
+                         instances + begin);
+  });
+  frame.transform_ms = millisecondsSince(start);
+  return frame;
+}
+
+// False if any thread count's results differ from the serial ones
+bool run(int n_cubes) {
+  const CubeScene scene = makeCubeScene(n_cubes);
+  const Frustum frustum = makeView(scene);
+  std::vector<int> visible;
+  visible.reserve(n_cubes);
+  std::vector<glm::mat4> instances(n_cubes);
+
+  JobSystem serial(1);
+  update(serial, scene, frustum, 1.0f, visible, instances.data());
+  const std::vector<int> expected_visible = visible;
+  const std::vector<glm::mat4> expected(instances.begin(),
+                                        instances.begin() + visible.size());
+  std::cout << n_cubes << " cubes, " << visible.size() << " visible"
+            << std::endl;
+
+  const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  double single_ms = 0.0;
+  bool passed = true;
+  for (int threads = 1;; threads = std::min(2 * threads, max_threads)) {
+    JobSystem jobs(threads);
+    double cull_ms = 0.0, transform_ms = 0.0;
+    for (int frame = 0; frame < kFrames; frame++) {
+      std::fill(instances.begin(), instances.end(), glm::mat4(0.0f));
+      Frame timings =
+          update(jobs, scene, frustum, 1.0f, visible, instances.data());
+      cull_ms += timings.cull_ms;
+      transform_ms += timings.transform_ms;
+    }
+    cull_ms /= kFrames;
+    transform_ms /= kFrames;
+    double total_ms = cull_ms + transform_ms;
+    if (threads == 1) {
+      single_ms = total_ms;
+    }
+    bool matches =
+        visible == expected_visible &&
+        std::memcmp(instances.data(), expected.data(),
+                    expected.size() * sizeof(glm::mat4)) == 0;
+    std::cout << "  " << threads << " threads: cull " << cull_ms
+              << " ms  matrices " << transform_ms << " ms  total " << total_ms
+              << " ms  (" << single_ms / total_ms << "x)"
+              << (matches ? "" : "  MISMATCH") << std::endl;
+    passed = passed && matches;
+    if (threads == max_threads) {
+      break;
+    }
+  }
+  return passed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<int> sizes;
+  for (int i = 1; i < argc; i++) {
+    sizes.push_back(std::atoi(argv[i]));
+  }
+  if (sizes.empty()) {
+    sizes = {1000000};
+  }
+  bool passed = true;
+  for (int n : sizes) {
+    passed = run(n) && passed;
+  }
+  return passed ? 0 : 1;
+}
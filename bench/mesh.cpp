@@ -0,0 +1,75 @@
+// Benchmark: vertex cache optimization of a regular grid.
+//   - ACMR of the grid in row order, with its triangles shuffled, and after
+//     optimizeVertexCache() on the shuffled order
+//   - optimizer time
+// Usage: bench_mesh [N...]   (N x N quad grids, defaults to 64, 256 and 1024)
+// CPU only, no GL context needed.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "mesh.h"
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void run(int n) {
+  // (n + 1)^2 vertices, two triangles per quad, row by row
+  std::vector<uint32_t> indices;
+  for (int y = 0; y < n; y++) {
+    for (int x = 0; x < n; x++) {
+      uint32_t v = y * (n + 1) + x;
+      uint32_t quad[6] = {v, v + 1, v + n + 1, v + 1, v + n + 2, v + n + 1};
+      indices.insert(indices.end(), quad, quad + 6);
+    }
+  }
+  const int n_vertices = (n + 1) * (n + 1);
+  float row_order = acmr(indices.data(), indices.size(), VERTEX_CACHE_SIZE);
+
+  // as a mesh exported without care might come
+  std::vector<int> order(indices.size() / 3);
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = (int)i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(1));
+  std::vector<uint32_t> shuffled;
+  for (int t : order) {
+    shuffled.insert(shuffled.end(), &indices[3 * t], &indices[3 * t + 3]);
+  }
+  float shuffled_acmr =
+      acmr(shuffled.data(), shuffled.size(), VERTEX_CACHE_SIZE);
+
+  auto start = std::chrono::steady_clock::now();
+  optimizeVertexCache(shuffled, n_vertices);
+  double optimize_ms = millisecondsSince(start);
+  float optimized = acmr(shuffled.data(), shuffled.size(), VERTEX_CACHE_SIZE);
+
+  std::cout << n << "x" << n << " grid, " << order.size() << " triangles\n"
+            << "  ACMR row order: " << row_order
+            << "  shuffled: " << shuffled_acmr << "  optimized: " << optimized
+            << "\n  optimize: " << optimize_ms << " ms" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<int> sizes;
+  for (int i = 1; i < argc; i++) {
+    sizes.push_back(std::atoi(argv[i]));
+  }
+  if (sizes.empty()) {
+    sizes = {64, 256, 1024};
+  }
+  for (int n : sizes) {
+    run(n);
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+// Benchmark: batched model matrices against the glm loop they replace.
+//   - ns per matrix of CubeScene::model() and composeModelMatrices(), over
+//     every cube and over a shuffled half of them (as after culling)
+//   - largest difference from glm in ULPs, relative to max(|element|, 1),
+//     at several times, over every cube and through a culled index list
+//     whose length is no multiple of the SIMD width
+//   - every SIMD result against the scalar path, which must match exactly
+// Exits with 1 above MAX_ULPS or on any scalar mismatch.
+// Usage: bench_transforms [N...]   (defaults to 1M cubes)
+// CPU only, no GL context needed.
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "scene.h"
+#include "transforms.h"
+
+namespace {
+
+const int kRepeats = 5;
+// Animation times the results are checked at, in seconds
+const float kTimes[] = {0.0f, 0.37f, 12.5f, 600.0f, 3600.0f};
+// 2.75 measured; up to 7.5 once an FMA build contracts glm's expressions,
+// which the kernel, built with contraction off, does not
+const float MAX_ULPS = 10.0f;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Fastest of kRepeats runs of |f|, in ns per matrix
+template <class F>
+double nsPerMatrix(int count, F f) {
+  double best = 1e30;
+  for (int repeat = 0; repeat < kRepeats; repeat++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    best = std::min(best, millisecondsSince(start));
+  }
+  return best * 1e6 / count;
+}
+
+// Over the first |count| matrices
+float maxUlps(const std::vector<glm::mat4>& expected,
+              const std::vector<glm::mat4>& actual,
+              int count) {
+  float worst = 0.0f;
+  for (int i = 0; i < count; i++) {
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        float e = expected[i][column][row];
+        float a = actual[i][column][row];
+        float ulps = std::fabs(a - e) /
+                     (std::max(std::fabs(e), 1.0f) * FLT_EPSILON);
+        worst = std::max(worst, ulps);
+      }
+    }
+  }
+  return worst;
+}
+
+bool run(int n_cubes) {
+  const CubeScene scene = makeCubeScene(n_cubes);
+  std::vector<int> half(n_cubes);
+  for (int i = 0; i < n_cubes; i++) {
+    half[i] = i;
+  }
+  std::shuffle(half.begin(), half.end(), std::mt19937(1));
+  half.resize(n_cubes / 2);
+  std::sort(half.begin(), half.end());
+
+  std::vector<glm::mat4> expected(n_cubes);
+  std::vector<glm::mat4> actual(n_cubes);
+  const float t = kTimes[1];
+  double glm_ns = nsPerMatrix(n_cubes, [&] {
+    for (int i = 0; i < n_cubes; i++) {
+      expected[i] = scene.model(i, t);
+    }
+  });
+  double batched_ns = nsPerMatrix(n_cubes, [&] {
+    composeModelMatrices(scene, NULL, n_cubes, t, actual.data());
+  });
+  const int n_half = (int)half.size();
+  double glm_half_ns = nsPerMatrix(n_half, [&] {
+    for (int i = 0; i < n_half; i++) {
+      expected[i] = scene.model(half[i], t);
+    }
+  });
+  double batched_half_ns = nsPerMatrix(n_half, [&] {
+    composeModelMatrices(scene, half.data(), n_half, t, actual.data());
+  });
+
+  // Checked through contiguous loads, through gathers from the index list,
+  // and with a count that leaves a scalar tail. Every path must also give
+  // the same bits as composing the cube alone, which takes the scalar path.
+  const int n_tail = n_half < 8 ? n_half : n_half - (n_half % 8 + 1) % 8;
+  float worst = 0.0f, worst_indexed = 0.0f;
+  int inconsistent = 0;
+  for (float time : kTimes) {
+    for (int i = 0; i < n_cubes; i++) {
+      expected[i] = scene.model(i, time);
+    }
+    composeModelMatrices(scene, NULL, n_cubes, time, actual.data());
+    worst = std::max(worst, maxUlps(expected, actual, n_cubes));
+    for (int i = 0; i < n_cubes; i++) {
+      glm::mat4 single;
+      composeModelMatrices(scene, &i, 1, time, &single);
+      inconsistent += std::memcmp(&single, &actual[i], sizeof(single)) != 0;
+    }
+
+    for (int i = 0; i < n_tail; i++) {
+      expected[i] = scene.model(half[i], time);
+    }
+    composeModelMatrices(scene, half.data(), n_tail, time, actual.data());
+    worst_indexed = std::max(worst_indexed, maxUlps(expected, actual, n_tail));
+    for (int i = 0; i < n_tail; i++) {
+      glm::mat4 single;
+      composeModelMatrices(scene, &half[i], 1, time, &single);
+      inconsistent += std::memcmp(&single, &actual[i], sizeof(single)) != 0;
+    }
+  }
+
+  std::cout << n_cubes << " cubes, " << transformKernelIsa() << " kernel\n"
+            << "  all:    glm " << glm_ns << " ns  batched " << batched_ns
+            << " ns  (" << glm_ns / batched_ns << "x)\n"
+            << "  culled: glm " << glm_half_ns << " ns  batched "
+            << batched_half_ns << " ns  (" << glm_half_ns / batched_half_ns
+            << "x)\n"
+            << "  max error " << worst << " ULPs, indexed " << worst_indexed
+            << " ULPs over " << n_tail << " cubes\n"
+            << "  matrices differing from the scalar path: " << inconsistent
+            << std::endl;
+  bool passed = true;
+  if (std::max(worst, worst_indexed) > MAX_ULPS) {
+    std::cout << "  FAILED: above " << MAX_ULPS << " ULPs" << std::endl;
+    passed = false;
+  }
+  if (inconsistent) {
+    std::cout << "  FAILED: SIMD and scalar paths disagree" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<int> sizes;
+  for (int i = 1; i < argc; i++) {
+    sizes.push_back(std::atoi(argv[i]));
+  }
+  if (sizes.empty()) {
+    sizes = {1000000};
+  }
+  bool passed = true;
+  for (int n : sizes) {
+    passed = run(n) && passed;
+  }
+  return passed ? 0 : 1;
+}
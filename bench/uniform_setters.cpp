@@ -0,0 +1,92 @@
+// Microbenchmark: cost of setting a mat4 uniform through
+//   1. the original setter (std::string + glGetUniformLocation per call),
+//   2. the cached name lookup,
+//   3. a pre-resolved Shader::Uniform handle.
+// Run from the repository root so the shader paths resolve.
+#include <glad/glad.h>
+////////////// line here for linter glad.h must be first
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <string>
+
+#include "gl_ext.h"
+#include "shader.h"
+
+namespace {
+
+const int kIterations = 1000000;
+
+// The setter as it was before uniform locations were cached
+void legacySetMat4(unsigned int program,
+                   const std::string& name,
+                   const glm::mat4& mat) {
+  glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE,
+                     &mat[0][0]);
+}
+
+template <typename F>
+double nanosecondsPerCall(F f) {
+  glFinish();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++) {
+    f(i);
+  }
+  glFinish();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "bench", NULL, NULL);
+  if (window == NULL) {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  glfwMakeContextCurrent(window);
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+  gl_ext::load((GLADloadproc)glfwGetProcAddress);
+
+  Shader shader("src/shaders/vertex/vertex.vs",
+                "src/shaders/fragment/texture.frag");
+  shader.use();
+  glm::mat4 mat(1.0f);
+  const Shader::Uniform model = shader.uniform("model");
+
+  double legacy = nanosecondsPerCall([&](int i) {
+    mat[3][0] = (float)i;
+    legacySetMat4(shader.id(), "model", mat);
+  });
+  double by_name = nanosecondsPerCall([&](int i) {
+    mat[3][0] = (float)i;
+    shader.set_mat4("model", mat);
+  });
+  double by_handle = nanosecondsPerCall([&](int i) {
+    mat[3][0] = (float)i;
+    shader.set_mat4(model, mat);
+  });
+
+  std::cout << "set_mat4 x " << kIterations << " (ns/call)\n"
+            << "  std::string + glGetUniformLocation: " << legacy << "\n"
+            << "  cached name lookup:                 " << by_name << "\n"
+            << "  Shader::Uniform handle:             " << by_handle
+            << std::endl;
+
+  shader.Delete();
+  glfwTerminate();
+  return 0;
+}
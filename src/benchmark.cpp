@@ -0,0 +1,140 @@
+#include "benchmark.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+double nowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Nearest-rank percentile of sorted |values|
+double percentile(const std::vector<double>& values, double p) {
+  size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+  return values[std::max<size_t>(rank, 1) - 1];
+}
+
+// Returns the samples stored under |name|, adding an empty entry if needed
+std::vector<double>& samplesFor(
+    std::vector<std::pair<std::string, std::vector<double>>>& series,
+    const char* name) {
+  for (auto& entry : series) {
+    if (entry.first == name) {
+      return entry.second;
+    }
+  }
+  series.emplace_back(name, std::vector<double>());
+  return series.back().second;
+}
+
+void writeStats(std::ostream& out, const FrameTimeStats& stats) {
+  out << "{\"mean\": " << stats.mean << ", \"p50\": " << stats.p50
+      << ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99
+      << ", \"max\": " << stats.max << ", \"samples\": " << stats.samples
+      << "}";
+}
+
+}  // namespace
+
+void scriptedCameraPose(float t,
+                        const glm::vec3& center,
+                        float radius,
+                        Camera& camera) {
+  float angle = 0.25f * t;
+  glm::vec3 position =
+      center + glm::vec3(radius * std::sin(angle),
+                         0.3f * radius * std::sin(0.5f * angle),
+                         radius * std::cos(angle));
+  glm::vec3 direction = glm::normalize(center - position);
+  float yaw = glm::degrees(std::atan2(direction.z, direction.x));
+  float pitch = glm::degrees(std::asin(direction.y));
+  camera.SetPose(position, yaw, pitch);
+}
+
+FrameTimeStats computeStats(std::vector<double> samples_ms) {
+  FrameTimeStats stats;
+  stats.samples = (int)samples_ms.size();
+  if (samples_ms.empty()) {
+    return stats;
+  }
+  std::sort(samples_ms.begin(), samples_ms.end());
+  double sum = 0.0;
+  for (double sample : samples_ms) {
+    sum += sample;
+  }
+  stats.mean = sum / samples_ms.size();
+  stats.p50 = percentile(samples_ms, 50);
+  stats.p95 = percentile(samples_ms, 95);
+  stats.p99 = percentile(samples_ms, 99);
+  stats.max = samples_ms.back();
+  return stats;
+}
+
+FrameBenchmark::FrameBenchmark(int warmup_frames, int measured_frames)
+    : warmup_frames_(warmup_frames), measured_frames_(measured_frames) {
+  cpu_ms_.reserve(measured_frames);
+  gpu_ms_.reserve(measured_frames);
+}
+
+void FrameBenchmark::beginFrame() {
+  frame_start_ms_ = nowMs();
+}
+
+void FrameBenchmark::endFrame(GpuProfiler& profiler) {
+  if (frame_ >= warmup_frames_) {
+    cpu_ms_.push_back(nowMs() - frame_start_ms_);
+  }
+  collectGpuResults(profiler);
+  frame_++;
+}
+
+bool FrameBenchmark::done() const {
+  return frame_ >= warmup_frames_ + measured_frames_;
+}
+
+void FrameBenchmark::recordCounter(const char* name, double value) {
+  if (frame_ >= warmup_frames_) {
+    samplesFor(counters_, name).push_back(value);
+  }
+}
+
+void FrameBenchmark::collectGpuResults(GpuProfiler& profiler) {
+  GpuProfiler::FrameTiming timing;
+  while (profiler.popResult(timing)) {
+    if (timing.frame < warmup_frames_) {
+      continue;
+    }
+    gpu_ms_.push_back(timing.total_ms);
+    for (const GpuProfiler::PassTiming& pass : timing.passes) {
+      samplesFor(gpu_pass_ms_, pass.name).push_back(pass.ms);
+    }
+  }
+}
+
+void FrameBenchmark::writeReport(std::ostream& out,
+                                 const char* config_json,
+                                 GpuProfiler& profiler) {
+  profiler.flush();
+  collectGpuResults(profiler);
+  out << "{\n  \"config\": " << config_json << ",\n  \"cpu_frame_ms\": ";
+  writeStats(out, computeStats(cpu_ms_));
+  out << ",\n  \"gpu_frame_ms\": ";
+  writeStats(out, computeStats(gpu_ms_));
+  out << ",\n  \"gpu_pass_ms\": {";
+  for (size_t i = 0; i < gpu_pass_ms_.size(); i++) {
+    out << (i ? ",\n" : "\n") << "    \"" << gpu_pass_ms_[i].first << "\": ";
+    writeStats(out, computeStats(gpu_pass_ms_[i].second));
+  }
+  out << "\n  },\n  \"counters\": {";
+  for (size_t i = 0; i < counters_.size(); i++) {
+    out << (i ? ",\n" : "\n") << "    \"" << counters_[i].first << "\": ";
+    writeStats(out, computeStats(counters_[i].second));
+  }
+  out << "\n  }\n}" << std::endl;
+}
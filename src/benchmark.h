@@ -0,0 +1,74 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camera.h"
+#include "gpu_profiler.h"
+
+// Timestep of --benchmark runs. Time advances by exactly this much per frame
+// so every run animates and moves the camera identically.
+const float BENCHMARK_TIMESTEP = 1.0f / 60.0f;
+
+// Places |camera| on the scripted benchmark path at time |t|: a slow orbit
+// around |center| at |radius|, bobbing up and down, always facing the center
+void scriptedCameraPose(float t,
+                        const glm::vec3& center,
+                        float radius,
+                        Camera& camera);
+
+// Mean and percentiles of a set of frame times, in milliseconds
+struct FrameTimeStats {
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+  int samples = 0;
+};
+
+FrameTimeStats computeStats(std::vector<double> samples_ms);
+
+// Records CPU time of every frame after the warmup, and the GPU frame and
+// per-pass times the GpuProfiler reports for those frames.
+class FrameBenchmark {
+ public:
+  FrameBenchmark(int warmup_frames, int measured_frames);
+
+  // Call at the very start and end of each frame; the end includes the
+  // buffer swap. |profiler| must be the one bracketing the same frames.
+  void beginFrame();
+  void endFrame(GpuProfiler& profiler);
+  // True once every measured frame has been rendered
+  bool done() const;
+  // Adds one sample of a per-frame statistic, such as the number of culled
+  // objects. Call between beginFrame() and endFrame(); ignored during warmup.
+  // Reported under "counters".
+  void recordCounter(const char* name, double value);
+
+  // Waits for the outstanding GPU results and writes the report as JSON.
+  // |config_json| is copied verbatim as the "config" object.
+  void writeReport(std::ostream& out,
+                   const char* config_json,
+                   GpuProfiler& profiler);
+
+ private:
+  // Moves the profiler's completed measured frames into the samples
+  void collectGpuResults(GpuProfiler& profiler);
+
+  int warmup_frames_;
+  int measured_frames_;
+  int frame_ = 0;
+  double frame_start_ms_ = 0.0;
+  std::vector<double> cpu_ms_;
+  std::vector<double> gpu_ms_;
+  // Per-pass GPU samples in the order passes first appeared
+  std::vector<std::pair<std::string, std::vector<double>>> gpu_pass_ms_;
+  // Counter samples in the order counters first appeared
+  std::vector<std::pair<std::string, std::vector<double>>> counters_;
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+namespace {
+
+// Subtrees with fewer primitives than this are not worth a thread
+const uint32_t PARALLEL_BUILD_THRESHOLD = 1 << 16;
+
+Aabb emptyBox() {
+  return {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+
+void grow(Aabb& box, const Aabb& other) {
+  for (int axis = 0; axis < 3; axis++) {
+    box.min[axis] = std::min(box.min[axis], other.min[axis]);
+    box.max[axis] = std::max(box.max[axis], other.max[axis]);
+  }
+}
+
+float halfArea(const Aabb& box) {
+  float dx = box.max[0] - box.min[0];
+  float dy = box.max[1] - box.min[1];
+  float dz = box.max[2] - box.min[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+void copyBox(BvhNode& node, const Aabb& box) {
+  for (int axis = 0; axis < 3; axis++) {
+    node.min[axis] = box.min[axis];
+    node.max[axis] = box.max[axis];
+  }
+}
+
+Aabb nodeBox(const BvhNode& node) {
+  return {{node.min[0], node.min[1], node.min[2]},
+          {node.max[0], node.max[1], node.max[2]}};
+}
+
+}  // namespace
+
+struct Bvh::BuildContext {
+  // Primitive boxes with their index, partitioned in place as nodes split so
+  // every pass over a node reads contiguous memory
+  struct Reference {
+    Aabb box;
+    uint32_t index;
+
+    // Twice the box center; only compared against itself
+    float centroid(int axis) const { return box.min[axis] + box.max[axis]; }
+  };
+  std::vector<Reference> references;
+};
+
+void Bvh::build(const Aabb* bounds, int count, int max_threads) {
+  nodes_.clear();
+  indices_.resize(count);
+  if (count == 0) {
+    return;
+  }
+
+  BuildContext context;
+  context.references.resize(count);
+  Aabb box = emptyBox();
+  for (int i = 0; i < count; i++) {
+    context.references[i].box = bounds[i];
+    context.references[i].index = (uint32_t)i;
+    grow(box, bounds[i]);
+  }
+
+  if (max_threads <= 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // leaves hold at least one primitive, usually several
+  nodes_.reserve(count);
+  nodes_.push_back(BvhNode());
+  copyBox(nodes_[0], box);
+  buildNode(context, nodes_, 0, 0, count, max_threads);
+
+  for (int i = 0; i < count; i++) {
+    indices_[i] = context.references[i].index;
+  }
+}
+
+void Bvh::buildNode(BuildContext& context,
+                    std::vector<BvhNode>& nodes,
+                    uint32_t node_index,
+                    uint32_t begin,
+                    uint32_t end,
+                    int threads) {
+  typedef BuildContext::Reference Reference;
+  Reference* references = context.references.data();
+  uint32_t count = end - begin;
+  if (count <= MAX_LEAF_SIZE) {
+    nodes[node_index].first = begin;
+    nodes[node_index].count = count;
+    return;
+  }
+
+  // bin centroids along the axis they spread the most
+  float centroid_min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float centroid_max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = begin; i < end; i++) {
+    for (int a = 0; a < 3; a++) {
+      centroid_min[a] = std::min(centroid_min[a], references[i].centroid(a));
+      centroid_max[a] = std::max(centroid_max[a], references[i].centroid(a));
+    }
+  }
+  int axis = 0;
+  for (int a = 1; a < 3; a++) {
+    if (centroid_max[a] - centroid_min[a] >
+        centroid_max[axis] - centroid_min[axis]) {
+      axis = a;
+    }
+  }
+  const float extent = centroid_max[axis] - centroid_min[axis];
+
+  // split in the middle if every centroid coincides, as any split is as good
+  // as another
+  uint32_t mid = begin + count / 2;
+  Aabb left_box = emptyBox();
+  Aabb right_box = emptyBox();
+  bool binned = false;
+  if (extent > 0.0f) {
+    const float origin = centroid_min[axis];
+    const float scale = BINS / extent;
+    auto binOf = [&](const Reference& reference) {
+      int bin = (int)((reference.centroid(axis) - origin) * scale);
+      return std::min(bin, BINS - 1);
+    };
+
+    Aabb bin_boxes[BINS];
+    uint32_t bin_counts[BINS] = {};
+    for (Aabb& bin_box : bin_boxes) {
+      bin_box = emptyBox();
+    }
+    for (uint32_t i = begin; i < end; i++) {
+      int bin = binOf(references[i]);
+      grow(bin_boxes[bin], references[i].box);
+      bin_counts[bin]++;
+    }
+
+    // sweep from the right to get every right-hand side, then from the left
+    // to find the cheapest split
+    Aabb right_boxes[BINS];
+    uint32_t right_counts[BINS];
+    Aabb accumulated = emptyBox();
+    uint32_t accumulated_count = 0;
+    for (int bin = BINS - 1; bin > 0; bin--) {
+      grow(accumulated, bin_boxes[bin]);
+      accumulated_count += bin_counts[bin];
+      right_boxes[bin] = accumulated;
+      right_counts[bin] = accumulated_count;
+    }
+    accumulated = emptyBox();
+    accumulated_count = 0;
+    float best_cost = FLT_MAX;
+    int best_split = -1;
+    for (int split = 1; split < BINS; split++) {
+      grow(accumulated, bin_boxes[split - 1]);
+      accumulated_count += bin_counts[split - 1];
+      if (accumulated_count == 0 || right_counts[split] == 0) {
+        continue;
+      }
+      float cost = accumulated_count * halfArea(accumulated) +
+                   right_counts[split] * halfArea(right_boxes[split]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = split;
+        left_box = accumulated;
+      }
+    }
+
+    if (best_split > 0) {
+      right_box = right_boxes[best_split];
+      mid = (uint32_t)(std::partition(references + begin, references + end,
+                                      [&](const Reference& reference) {
+                                        return binOf(reference) < best_split;
+                                      }) -
+                       references);
+      binned = true;
+    }
+  }
+  if (!binned) {
+    for (uint32_t i = begin; i < mid; i++) {
+      grow(left_box, references[i].box);
+    }
+    for (uint32_t i = mid; i < end; i++) {
+      grow(right_box, references[i].box);
+    }
+  }
+
+  uint32_t left = (uint32_t)nodes.size();
+  nodes[node_index].first = left;
+  nodes[node_index].count = 0;
+  nodes.push_back(BvhNode());
+  nodes.push_back(BvhNode());
+  copyBox(nodes[left], left_box);
+  copyBox(nodes[left + 1], right_box);
+
+  if (threads > 1 && count >= PARALLEL_BUILD_THRESHOLD) {
+    // build the right subtree into its own array on another thread, then
+    // splice it in after the left one
+    std::vector<BvhNode> right_nodes(1, nodes[left + 1]);
+    std::thread worker([&] {
+      buildNode(context, right_nodes, 0, mid, end, threads / 2);
+    });
+    buildNode(context, nodes, left, begin, mid, threads - threads / 2);
+    worker.join();
+
+    // right_nodes[0] goes into the reserved slot, the rest are appended
+    uint32_t offset = (uint32_t)nodes.size() - 1;
+    for (BvhNode& node : right_nodes) {
+      if (!node.leaf()) {
+        node.first += offset;
+      }
+    }
+    nodes[left + 1] = right_nodes[0];
+    nodes.insert(nodes.end(), right_nodes.begin() + 1, right_nodes.end());
+  } else {
+    buildNode(context, nodes, left, begin, mid, threads);
+    buildNode(context, nodes, left + 1, mid, end, threads);
+  }
+}
+
+void Bvh::refit(const Aabb* bounds) {
+  // children always come after their parent
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    BvhNode& node = nodes_[i];
+    Aabb box = emptyBox();
+    if (node.leaf()) {
+      for (uint32_t j = node.first; j < node.first + node.count; j++) {
+        grow(box, bounds[indices_[j]]);
+      }
+    } else {
+      grow(box, nodeBox(nodes_[node.first]));
+      grow(box, nodeBox(nodes_[node.first + 1]));
+    }
+    copyBox(node, box);
+  }
+}
+
+CullStats Bvh::cull(const Frustum& frustum,
+                    std::vector<int>& visible,
+                    BvhCullStats* stats) const {
+  size_t first_visible = visible.size();
+  BvhCullStats counters;
+  if (nodes_.empty()) {
+    return CullStats();
+  }
+
+  // each entry is a node and the planes it still straddles, one bit each;
+  // planes a parent lies entirely inside of need no test for its children
+  struct Entry {
+    uint32_t node;
+    uint32_t planes;
+  };
+  std::vector<Entry> stack;
+  stack.reserve(64);
+  stack.push_back({0, 0x3F});
+  while (!stack.empty()) {
+    Entry entry = stack.back();
+    stack.pop_back();
+    const BvhNode& node = nodes_[entry.node];
+    counters.nodes_tested++;
+
+    bool outside = false;
+    uint32_t straddled = 0;
+    for (int p = 0; p < 6 && !outside; p++) {
+      if (!(entry.planes & (1 << p))) {
+        continue;
+      }
+      const glm::vec4& plane = frustum.planes[p];
+      // corner furthest along the plane normal, and the one opposite it
+      float far_distance = plane.w, near_distance = plane.w;
+      for (int axis = 0; axis < 3; axis++) {
+        float n = plane[axis];
+        far_distance += n * (n >= 0.0f ? node.max[axis] : node.min[axis]);
+        near_distance += n * (n >= 0.0f ? node.min[axis] : node.max[axis]);
+      }
+      if (far_distance < 0.0f) {
+        outside = true;
+      } else if (near_distance < 0.0f) {
+        straddled |= 1 << p;
+      }
+    }
+    if (outside) {
+      continue;
+    }
+
+    if (node.leaf() || straddled == 0) {
+      if (!node.leaf()) {
+        counters.subtrees_accepted++;
+      }
+      // a subtree covers a contiguous run of indices_, from its leftmost
+      // leaf to its rightmost one
+      const BvhNode* leftmost = &node;
+      while (!leftmost->leaf()) {
+        leftmost = &nodes_[leftmost->first];
+      }
+      const BvhNode* rightmost = &node;
+      while (!rightmost->leaf()) {
+        rightmost = &nodes_[rightmost->first + 1];
+      }
+      uint32_t last = rightmost->first + rightmost->count;
+      for (uint32_t i = leftmost->first; i < last; i++) {
+        visible.push_back((int)indices_[i]);
+      }
+      continue;
+    }
+    stack.push_back({node.first + 1, straddled});
+    stack.push_back({node.first, straddled});
+  }
+
+  if (stats) {
+    *stats = counters;
+  }
+  CullStats result;
+  result.visible = (int)(visible.size() - first_visible);
+  result.culled = (int)indices_.size() - result.visible;
+  return result;
+}
+
+void sphereBounds(const float* x,
+                  const float* y,
+                  const float* z,
+                  float radius,
+                  int count,
+                  std::vector<Aabb>& bounds) {
+  bounds.resize(count);
+  for (int i = 0; i < count; i++) {
+    bounds[i] = {{x[i] - radius, y[i] - radius, z[i] - radius},
+                 {x[i] + radius, y[i] + radius, z[i] + radius}};
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"
+
+// Axis-aligned bounding box
+struct Aabb {
+  float min[3];
+  float max[3];
+};
+
+// Node of a Bvh, 32 bytes. Children of an inner node are stored as an
+// adjacent pair after their parent, so a reverse walk over the array visits
+// children before parents.
+struct BvhNode {
+  float min[3];
+  // Leaf: first entry of Bvh::indices() it covers. Inner: index of the left
+  // child; the right child follows it.
+  uint32_t first;
+  float max[3];
+  // Primitives in a leaf; 0 for inner nodes
+  uint32_t count;
+
+  bool leaf() const { return count > 0; }
+};
+
+// Extra counters of one Bvh::cull() call
+struct BvhCullStats {
+  // Nodes whose box was tested against the frustum
+  int nodes_tested = 0;
+  // Subtrees found entirely inside and accepted without further tests
+  int subtrees_accepted = 0;
+};
+
+// Bounding volume hierarchy over primitive AABBs, built top-down with a
+// binned surface area heuristic into one flat node array. Used to cull large
+// static scenes hierarchically: whole subtrees are rejected or accepted with
+// a single box test.
+class Bvh {
+ public:
+  // Most primitives a leaf may hold
+  static const int MAX_LEAF_SIZE = 4;
+  // Candidate split planes per axis
+  static const int BINS = 16;
+
+  // Builds over |count| primitive boxes. Subtrees are built in parallel on up
+  // to |max_threads| threads; 0 means one per hardware thread.
+  void build(const Aabb* bounds, int count, int max_threads = 0);
+
+  // Recomputes every node's box from updated primitive |bounds| (same count
+  // and order as build()). The tree topology is kept, so this is linear
+  // and cheap, but quality degrades if primitives move far.
+  void refit(const Aabb* bounds);
+
+  // Appends to |visible| the primitives of every leaf whose box is not
+  // entirely outside one of |frustum|'s planes. A leaf that straddles a
+  // plane is accepted whole, so this is a conservative superset of the
+  // primitives whose own boxes intersect |frustum|; with MAX_LEAF_SIZE
+  // primitives a leaf, a few more than cullSpheres() would keep.
+  CullStats cull(const Frustum& frustum,
+                 std::vector<int>& visible,
+                 BvhCullStats* stats = NULL) const;
+
+  const std::vector<BvhNode>& nodes() const { return nodes_; }
+  // Primitive indices in leaf order
+  const std::vector<uint32_t>& indices() const { return indices_; }
+
+ private:
+  struct BuildContext;
+
+  // Splits node |node_index|, whose box is already set and which covers
+  // build references [begin, end), and recurses. Nodes are appended to
+  // |nodes|; |threads| is this subtree's thread budget.
+  void buildNode(BuildContext& context,
+                 std::vector<BvhNode>& nodes,
+                 uint32_t node_index,
+                 uint32_t begin,
+                 uint32_t end,
+                 int threads);
+
+  std::vector<BvhNode> nodes_;
+  std::vector<uint32_t> indices_;
+};
+
+// Boxes of spheres of common |radius| centered at (x[i], y[i], z[i]); the
+// rotation-invariant bounds of the cubes
+void sphereBounds(const float* x,
+                  const float* y,
+                  const float* z,
+                  float radius,
+                  int count,
+                  std::vector<Aabb>& bounds);
+
+#endif
@@ -1,5 +1,7 @@
 #include "camera.h"
 
+#include "constants.h"
+
 // constructor with vectors
 Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch)
     : front_(glm::vec3(0.0f, 0.0f, -1.0f)),
@@ -37,6 +39,16 @@ glm::mat4 Camera::GetViewMatrix() {
   return glm::lookAt(position_, position_ + front_, up_);
 }
 
+glm::mat4 Camera::GetProjectionMatrix(float aspect_ratio) {
+  return glm::perspective(glm::radians(zoom_), aspect_ratio, constants::NEAR,
+                          constants::FAR);
+}
+
+Frustum Camera::GetFrustum(float aspect_ratio) {
+  return frustumFromMatrix(GetProjectionMatrix(aspect_ratio) *
+                           GetViewMatrix());
+}
+
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime) {
   float velocity = movement_speed_ * deltaTime;
   if (direction == FORWARD)
@@ -97,6 +109,13 @@ void Camera::updateCameraVectors() {
   up_ = glm::normalize(glm::cross(right_, front_));
 }
 
+void Camera::SetPose(glm::vec3 position, float yaw, float pitch) {
+  position_ = position;
+  yaw_ = yaw;
+  pitch_ = pitch;
+  updateCameraVectors();
+}
+
 float Camera::get_zoom() {
   return zoom_;
 }
\ No newline at end of file
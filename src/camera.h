@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "frustum.h"
+
 // Defines several possible options for camera movement. Used as abstraction to
 // stay away from window-system specific input methods
 enum Camera_Movement { FORWARD, BACKWARD, LEFT, RIGHT };
@@ -38,6 +40,13 @@ class Camera {
   // Returns the view matrix calculated using Euler Angles and the LookAt Matrix
   glm::mat4 GetViewMatrix();
 
+  // Returns the perspective projection for the current zoom, between
+  // constants::NEAR and constants::FAR
+  glm::mat4 GetProjectionMatrix(float aspect_ratio);
+
+  // Returns the six planes bounding what the camera sees
+  Frustum GetFrustum(float aspect_ratio);
+
   // Processes input received from any keyboard-like input system. Accepts input
   // parameter in the form of camera defined ENUM (to abstract it from windowing
   // systems)
@@ -53,6 +62,10 @@ class Camera {
   // input on the vertical wheel-axis
   void ProcessMouseScroll(float yoffset);
 
+  // Moves the camera to |position| facing the direction given by the Euler
+  // angles, in degrees. Used by scripted camera paths.
+  void SetPose(glm::vec3 position, float yaw, float pitch);
+
   float get_zoom();
 
  private:
@@ -0,0 +1,50 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "profiler.h"
+
+namespace {
+
+// glClientWaitSync timeout per try, in nanoseconds
+const GLuint64 WAIT_TIMEOUT = 1000000;
+
+}  // namespace
+
+FramePacer::FramePacer(int max_frames_in_flight)
+    : fences_(std::max(1, max_frames_in_flight), (GLsync)0) {}
+
+FramePacer::~FramePacer() {
+  for (GLsync fence : fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+}
+
+void FramePacer::beginFrame() {
+  last_wait_ms_ = 0.0;
+  GLsync& fence = fences_[slot_];
+  if (!fence) {
+    return;
+  }
+  PROFILE_ZONE("frame pacing");
+  auto start = std::chrono::steady_clock::now();
+  GLenum status = GL_TIMEOUT_EXPIRED;
+  while (status == GL_TIMEOUT_EXPIRED) {
+    // the flush makes sure the fence itself reaches the GPU
+    status =
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+  }
+  last_wait_ms_ = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  glDeleteSync(fence);
+  fence = 0;
+}
+
+void FramePacer::endFrame() {
+  fences_[slot_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot_ = (slot_ + 1) % (int)fences_.size();
+}
@@ -0,0 +1,38 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Caps how many frames the CPU may queue ahead of the GPU. endFrame() puts
+// a fence after the frame's last command; beginFrame() waits on the fence
+// of the frame |max_frames_in_flight| back, so at most that many frames are
+// ever submitted but unfinished.
+//
+// More frames in flight keep both processors busy; fewer make what is shown
+// more recent. With 1 the CPU starts a frame only once the GPU has finished
+// the one before, trading throughput for the least input latency.
+class FramePacer {
+ public:
+  explicit FramePacer(int max_frames_in_flight);
+  ~FramePacer();
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  // Blocks until a frame slot is free. Call before building the frame.
+  void beginFrame();
+  // Fences the frame. Call after presenting it.
+  void endFrame();
+
+  int maxFramesInFlight() const { return (int)fences_.size(); }
+  // Time the last beginFrame() spent blocked, in milliseconds
+  double lastWaitMs() const { return last_wait_ms_; }
+
+ private:
+  // Ring of fences, one per frame in flight; 0 when the slot is free
+  std::vector<GLsync> fences_;
+  int slot_ = 0;
+  double last_wait_ms_ = 0.0;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "frame_uniforms.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "gl_state.h"
+
+FrameUniformBuffer::FrameUniformBuffer()
+    : uniforms_(), dirty_begin_(0), dirty_end_(sizeof(uniforms_)) {
+
+  glGenBuffers(1, &buffer_);
+  gl_state::bindBuffer(GL_UNIFORM_BUFFER, buffer_);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(uniforms_), NULL, GL_DYNAMIC_DRAW);
+  // also binds the generic target, which the line above already did, so
+  // the state tracker stays right
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, buffer_);
+}
+
+FrameUniformBuffer::~FrameUniformBuffer() {
+  glDeleteBuffers(1, &buffer_);
+  gl_state::bufferDeleted(buffer_);
+}
+
+void FrameUniformBuffer::setProjection(const glm::mat4& projection) {
+  write(offsetof(FrameUniforms, projection), &projection,
+        sizeof(projection));
+}
+
+void FrameUniformBuffer::setView(const glm::mat4& view) {
+  write(offsetof(FrameUniforms, view), &view, sizeof(view));
+}
+
+void FrameUniformBuffer::setViewport(int x, int y, int width, int height) {
+  glm::vec4 viewport(x, y, width, height);
+  write(offsetof(FrameUniforms, viewport), &viewport, sizeof(viewport));
+}
+
+void FrameUniformBuffer::setTime(float time) {
+  write(offsetof(FrameUniforms, time), &time, sizeof(time));
+}
+
+size_t FrameUniformBuffer::upload() {
+  if (dirty_begin_ >= dirty_end_) {
+    return 0;
+  }
+  size_t size = dirty_end_ - dirty_begin_;
+  gl_state::bindBuffer(GL_UNIFORM_BUFFER, buffer_);
+  glBufferSubData(GL_UNIFORM_BUFFER, dirty_begin_, size,
+                  (const char*)&uniforms_ + dirty_begin_);
+  dirty_begin_ = sizeof(uniforms_);
+  dirty_end_ = 0;
+  return size;
+}
+
+void FrameUniformBuffer::write(size_t offset, const void* data, size_t size) {
+  char* destination = (char*)&uniforms_ + offset;
+  if (std::memcmp(destination, data, size) == 0) {
+    return;
+  }
+  std::memcpy(destination, data, size);
+  dirty_begin_ = std::min(dirty_begin_, offset);
+  dirty_end_ = std::max(dirty_end_, offset + size);
+}
@@ -0,0 +1,68 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uniform block every program may declare to read the per-frame state. The
+// GLSL side, std140 layout:
+//
+//   layout (std140) uniform FrameUniforms {
+//       mat4 projection;
+//       mat4 view;
+//       vec4 viewport;  // x, y, width, height in pixels
+//       float time;     // seconds
+//   };
+//
+// Shader binds the block to FRAME_UNIFORMS_BINDING after linking, so one
+// buffer bound there once serves every program.
+const char* const FRAME_UNIFORMS_BLOCK = "FrameUniforms";
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+
+// CPU copy of the block, laid out as std140 lays out the GLSL one
+struct FrameUniforms {
+  glm::mat4 projection;
+  glm::mat4 view;
+  glm::vec4 viewport;
+  float time;
+  float padding[3];
+};
+static_assert(offsetof(FrameUniforms, projection) == 0, "std140 mismatch");
+static_assert(offsetof(FrameUniforms, view) == 64, "std140 mismatch");
+static_assert(offsetof(FrameUniforms, viewport) == 128, "std140 mismatch");
+static_assert(offsetof(FrameUniforms, time) == 144, "std140 mismatch");
+static_assert(sizeof(FrameUniforms) == 160,
+              "std140 rounds the block up to a multiple of 16 bytes");
+
+// The uniform buffer holding FrameUniforms, bound at FRAME_UNIFORMS_BINDING.
+// Setters only touch the CPU copy, remembering which bytes actually changed;
+// upload() sends that one dirty range, or nothing.
+class FrameUniformBuffer {
+ public:
+  FrameUniformBuffer();
+  ~FrameUniformBuffer();
+  FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+  FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+  void setProjection(const glm::mat4& projection);
+  void setView(const glm::mat4& view);
+  void setViewport(int x, int y, int width, int height);
+  void setTime(float time);
+
+  // Copies the dirty range to the buffer. Call before the frame's draws.
+  // Returns the number of bytes sent.
+  size_t upload();
+
+ private:
+  // Copies |size| bytes to |offset| in the CPU copy if they differ
+  void write(size_t offset, const void* data, size_t size);
+
+  GLuint buffer_ = 0;
+  FrameUniforms uniforms_;
+  // Bytes [dirty_begin_, dirty_end_) differ from the buffer
+  size_t dirty_begin_;
+  size_t dirty_end_;
+};
+
+#endif
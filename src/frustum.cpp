@@ -0,0 +1,153 @@
+#include "frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "job_system.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
+Frustum frustumFromMatrix(const glm::mat4& m) {
+  // Gribb & Hartmann: each plane is row 3 +/- row 0..2 of the matrix. glm is
+  // column-major, so row r is (m[0][r], m[1][r], m[2][r], m[3][r]).
+  glm::vec4 rows[4];
+  for (int r = 0; r < 4; r++) {
+    rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+  }
+  Frustum frustum;
+  frustum.planes[0] = rows[3] + rows[0];  // left
+  frustum.planes[1] = rows[3] - rows[0];  // right
+  frustum.planes[2] = rows[3] + rows[1];  // bottom
+  frustum.planes[3] = rows[3] - rows[1];  // top
+  frustum.planes[4] = rows[3] + rows[2];  // near
+  frustum.planes[5] = rows[3] - rows[2];  // far
+  for (glm::vec4& plane : frustum.planes) {
+    float length = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                             plane.z * plane.z);
+    plane = plane / length;
+  }
+  return frustum;
+}
+
+namespace {
+
+bool sphereVisible(const Frustum& frustum,
+                   float x,
+                   float y,
+                   float z,
+                   float radius) {
+  for (const glm::vec4& plane : frustum.planes) {
+    if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes the indices in [begin, end) of the visible spheres to |visible|,
+// in increasing order, and returns how many there were
+int cullRange(const Frustum& frustum,
+              const float* x,
+              const float* y,
+              const float* z,
+              float radius,
+              int begin,
+              int end,
+              int* visible) {
+  int n_visible = 0;
+  int i = begin;
+#ifdef FRUSTUM_SSE
+  // splat every plane once, then test four spheres per iteration
+  __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+  for (int p = 0; p < 6; p++) {
+    plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+    plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+    plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+    plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+  }
+  const __m128 negative_radius = _mm_set1_ps(-radius);
+  for (; i + 4 <= end; i += 4) {
+    __m128 px = _mm_loadu_ps(x + i);
+    __m128 py = _mm_loadu_ps(y + i);
+    __m128 pz = _mm_loadu_ps(z + i);
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(plane_x[p], px), _mm_mul_ps(plane_y[p], py)),
+          _mm_add_ps(_mm_mul_ps(plane_z[p], pz), plane_w[p]));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_radius));
+    }
+    int outside_mask = _mm_movemask_ps(outside);
+    for (int lane = 0; lane < 4; lane++) {
+      if (!(outside_mask & (1 << lane))) {
+        visible[n_visible++] = i + lane;
+      }
+    }
+  }
+#endif
+  for (; i < end; i++) {
+    if (sphereVisible(frustum, x[i], y[i], z[i], radius)) {
+      visible[n_visible++] = i;
+    }
+  }
+  return n_visible;
+}
+
+}  // namespace
+
+CullStats cullSpheres(const Frustum& frustum,
+                      const float* x,
+                      const float* y,
+                      const float* z,
+                      float radius,
+                      int count,
+                      std::vector<int>& visible) {
+  size_t first = visible.size();
+  visible.resize(first + count);
+  CullStats stats;
+  stats.visible =
+      cullRange(frustum, x, y, z, radius, 0, count, visible.data() + first);
+  stats.culled = count - stats.visible;
+  visible.resize(first + stats.visible);
+  return stats;
+}
+
+CullStats cullSpheres(JobSystem& jobs,
+                      const Frustum& frustum,
+                      const float* x,
+                      const float* y,
+                      const float* z,
+                      float radius,
+                      int count,
+                      std::vector<int>& visible) {
+  // each block's survivors are written over the start of its own slots,
+  // then the blocks are packed in order
+  size_t first = visible.size();
+  visible.resize(first + count);
+  int* blocks_visible = visible.data() + first;
+  const int n_blocks = (count + CULL_BLOCK - 1) / CULL_BLOCK;
+  std::vector<int> block_sizes(n_blocks);
+  jobs.parallelFor(0, n_blocks, 1, [&](int block_begin, int block_end) {
+    for (int block = block_begin; block < block_end; block++) {
+      int begin = block * CULL_BLOCK;
+      block_sizes[block] =
+          cullRange(frustum, x, y, z, radius, begin,
+                    std::min(count, begin + CULL_BLOCK),
+                    blocks_visible + begin);
+    }
+  });
+  CullStats stats;
+  for (int block = 0; block < n_blocks; block++) {
+    const int* block_visible = blocks_visible + block * CULL_BLOCK;
+    std::copy(block_visible, block_visible + block_sizes[block],
+              blocks_visible + stats.visible);
+    stats.visible += block_sizes[block];
+  }
+  stats.culled = count - stats.visible;
+  visible.resize(first + stats.visible);
+  return stats;
+}
@@ -0,0 +1,52 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+// View frustum as six planes (left, right, bottom, top, near, far) with
+// normals pointing inwards: a point p is inside plane i when
+// dot(planes[i].xyz, p) + planes[i].w >= 0. Planes are normalized so that
+// value is a distance.
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// Extracts the planes of clip_from_world (projection * view)
+Frustum frustumFromMatrix(const glm::mat4& clip_from_world);
+
+// Visible/culled counts of one culling pass
+struct CullStats {
+  int visible = 0;
+  int culled = 0;
+};
+
+// Tests |count| spheres of common |radius| centered at (x[i], y[i], z[i])
+// and appends the indices of those at least partly inside |frustum| to
+// |visible|, in increasing order. Four spheres are tested at a time with SSE
+// where available.
+CullStats cullSpheres(const Frustum& frustum,
+                      const float* x,
+                      const float* y,
+                      const float* z,
+                      float radius,
+                      int count,
+                      std::vector<int>& visible);
+
+// Spheres per block of the parallel cullSpheres()
+const int CULL_BLOCK = 16384;
+
+// cullSpheres() with blocks of CULL_BLOCK spheres tested in parallel on
+// |jobs|; same results
+CullStats cullSpheres(JobSystem& jobs,
+                      const Frustum& frustum,
+                      const float* x,
+                      const float* y,
+                      const float* z,
+                      float radius,
+                      int count,
+                      std::vector<int>& visible);
+
+#endif
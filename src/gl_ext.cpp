@@ -0,0 +1,95 @@
+#include "gl_ext.h"
+
+#include <cstring>
+
+namespace gl_ext {
+
+PFNGLGETPROGRAMBINARYPROC GetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC ProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC ProgramParameteri = NULL;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreadsKHR = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = NULL;
+PFNGLDRAWELEMENTSINDIRECTPROC DrawElementsIndirect = NULL;
+PFNGLDISPATCHCOMPUTEPROC DispatchCompute = NULL;
+PFNGLMEMORYBARRIERPROC MemoryBarrierGL = NULL;
+PFNGLBUFFERSTORAGEPROC BufferStorage = NULL;
+
+void load(GLADloadproc loader) {
+  GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)loader("glGetProgramBinary");
+  ProgramBinary = (PFNGLPROGRAMBINARYPROC)loader("glProgramBinary");
+  ProgramParameteri =
+      (PFNGLPROGRAMPARAMETERIPROC)loader("glProgramParameteri");
+  MaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader(
+      "glMaxShaderCompilerThreadsKHR");
+  if (!MaxShaderCompilerThreadsKHR) {
+    // the ARB flavour has the same signature and enums
+    MaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader(
+        "glMaxShaderCompilerThreadsARB");
+  }
+  MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)loader(
+      "glMultiDrawElementsIndirect");
+  DrawElementsIndirect =
+      (PFNGLDRAWELEMENTSINDIRECTPROC)loader("glDrawElementsIndirect");
+  DispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)loader("glDispatchCompute");
+  MemoryBarrierGL = (PFNGLMEMORYBARRIERPROC)loader("glMemoryBarrier");
+  BufferStorage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorage");
+}
+
+bool hasVersion(int major, int minor) {
+  return GLVersion.major > major ||
+         (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool hasExtension(const char* name) {
+  int n_extensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n_extensions);
+  for (int i = 0; i < n_extensions; i++) {
+    const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+    if (extension && std::strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hasProgramBinary() {
+  if (!GetProgramBinary || !ProgramBinary || !ProgramParameteri) {
+    return false;
+  }
+  if (!hasVersion(4, 1) && !hasExtension("GL_ARB_get_program_binary")) {
+    return false;
+  }
+  // drivers may expose the entry points yet support no binary format
+  int n_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  return n_formats > 0;
+}
+
+bool hasParallelShaderCompile() {
+  return hasExtension("GL_KHR_parallel_shader_compile") ||
+         hasExtension("GL_ARB_parallel_shader_compile");
+}
+
+bool hasMultiDrawIndirect() {
+  if (!MultiDrawElementsIndirect) {
+    return false;
+  }
+  return hasVersion(4, 3) || (hasExtension("GL_ARB_multi_draw_indirect") &&
+                              hasExtension("GL_ARB_base_instance"));
+}
+
+bool hasComputeShader() {
+  if (!DrawElementsIndirect || !DispatchCompute || !MemoryBarrierGL) {
+    return false;
+  }
+  return hasVersion(4, 3);
+}
+
+bool hasBufferStorage() {
+  if (!BufferStorage) {
+    return false;
+  }
+  return hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage");
+}
+
+}  // namespace gl_ext
@@ -0,0 +1,114 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+// Entry points and enums newer than the GL 3.3 profile glad was generated
+// for. They are resolved at run time by gl_ext::load(); a pointer stays NULL
+// when the driver does not provide it, so check before calling.
+
+// GL 4.1 / ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+// GL 4.0 / ARB_draw_indirect
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+
+// GL 4.3 / ARB_compute_shader, ARB_shader_storage_buffer_object
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+
+// GL 4.4 / ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+
+namespace gl_ext {
+
+// One draw of glMultiDrawElementsIndirect, as laid out in the indirect
+// buffer
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  // Instanced attributes start at this instance (GL 4.2)
+  GLuint base_instance;
+};
+
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program,
+                                                  GLsizei bufSize,
+                                                  GLsizei* length,
+                                                  GLenum* binaryFormat,
+                                                  void* binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program,
+                                               GLenum binaryFormat,
+                                               const void* binary,
+                                               GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program,
+                                                   GLenum pname,
+                                                   GLint value);
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+typedef void(APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(
+    GLenum mode,
+    GLenum type,
+    const void* indirect,
+    GLsizei drawcount,
+    GLsizei stride);
+typedef void(APIENTRYP PFNGLDRAWELEMENTSINDIRECTPROC)(GLenum mode,
+                                                      GLenum type,
+                                                      const void* indirect);
+typedef void(APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x,
+                                                 GLuint num_groups_y,
+                                                 GLuint num_groups_z);
+typedef void(APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target,
+                                               GLsizeiptr size,
+                                               const void* data,
+                                               GLbitfield flags);
+
+extern PFNGLGETPROGRAMBINARYPROC GetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC ProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreadsKHR;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+extern PFNGLDRAWELEMENTSINDIRECTPROC DrawElementsIndirect;
+extern PFNGLDISPATCHCOMPUTEPROC DispatchCompute;
+// Not plain MemoryBarrier, which <windows.h> defines as a macro
+extern PFNGLMEMORYBARRIERPROC MemoryBarrierGL;
+extern PFNGLBUFFERSTORAGEPROC BufferStorage;
+
+// Resolves every entry point above. Call once, right after gladLoadGLLoader,
+// with the same loader.
+void load(GLADloadproc loader);
+
+// True if the current context is at least version major.minor
+bool hasVersion(int major, int minor);
+// True if the current context advertises the extension |name|
+bool hasExtension(const char* name);
+
+// True if programs can be saved and restored with Get/ProgramBinary
+bool hasProgramBinary();
+// True if GL_COMPLETION_STATUS_KHR can be polled on shaders and programs
+bool hasParallelShaderCompile();
+// True if MultiDrawElementsIndirect can be called and honours base_instance
+bool hasMultiDrawIndirect();
+// True if compute shaders with shader storage buffers can write draws for
+// DrawElementsIndirect
+bool hasComputeShader();
+// True if BufferStorage can create immutable, persistently mappable buffers
+bool hasBufferStorage();
+
+}  // namespace gl_ext
+
+#endif
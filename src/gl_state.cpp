@@ -0,0 +1,245 @@
+#include "gl_state.h"
+
+#include <cstddef>
+
+#include "gl_ext.h"
+
+namespace gl_state {
+
+namespace {
+
+// Shadow value not known; no GL name or enum has it
+const GLuint UNKNOWN = ~0u;
+
+// Buffer and texture targets with a shadow slot
+const GLenum BUFFER_TARGETS[] = {
+    GL_ARRAY_BUFFER,        GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER,
+    GL_COPY_READ_BUFFER,    GL_COPY_WRITE_BUFFER,    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER, GL_DRAW_INDIRECT_BUFFER};
+const int N_BUFFER_TARGETS = sizeof(BUFFER_TARGETS) / sizeof(GLenum);
+const GLenum TEXTURE_TARGETS[] = {GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP,
+                                  GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D,
+                                  GL_TEXTURE_BUFFER};
+const int N_TEXTURE_TARGETS = sizeof(TEXTURE_TARGETS) / sizeof(GLenum);
+const GLenum CAPABILITIES[] = {GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE,
+                               GL_SCISSOR_TEST, GL_STENCIL_TEST};
+const int N_CAPABILITIES = sizeof(CAPABILITIES) / sizeof(GLenum);
+
+struct Shadow {
+  GLuint program;
+  GLuint vao;
+  GLuint buffers[N_BUFFER_TARGETS];
+  GLuint active_texture;
+  GLuint textures[MAX_TEXTURE_UNITS][N_TEXTURE_TARGETS];
+  GLuint capabilities[N_CAPABILITIES];
+  GLuint depth_func;
+  GLuint depth_mask;
+  GLuint blend_source;
+  GLuint blend_destination;
+  // RGBA bits, or UNKNOWN
+  GLuint color_mask;
+};
+
+Shadow unknownShadow() {
+  Shadow shadow;
+  shadow.program = UNKNOWN;
+  shadow.vao = UNKNOWN;
+  for (GLuint& buffer : shadow.buffers) {
+    buffer = UNKNOWN;
+  }
+  shadow.active_texture = UNKNOWN;
+  for (GLuint(&unit)[N_TEXTURE_TARGETS] : shadow.textures) {
+    for (GLuint& texture : unit) {
+      texture = UNKNOWN;
+    }
+  }
+  for (GLuint& capability : shadow.capabilities) {
+    capability = UNKNOWN;
+  }
+  shadow.depth_func = UNKNOWN;
+  shadow.depth_mask = UNKNOWN;
+  shadow.blend_source = UNKNOWN;
+  shadow.blend_destination = UNKNOWN;
+  shadow.color_mask = UNKNOWN;
+  return shadow;
+}
+
+Shadow SHADOW = unknownShadow();
+Counters COUNTERS;
+
+int indexOf(const GLenum* values, int count, GLenum value) {
+  for (int i = 0; i < count; i++) {
+    if (values[i] == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Records |value| in |shadow|. Returns true if the GL call is needed.
+bool change(GLuint& shadow, GLuint value) {
+  if (shadow == value) {
+    COUNTERS.elided++;
+    return false;
+  }
+  shadow = value;
+  COUNTERS.issued++;
+  return true;
+}
+
+void forget(GLuint& shadow, GLuint name) {
+  if (shadow == name) {
+    shadow = UNKNOWN;
+  }
+}
+
+void setCapability(GLenum capability, GLuint enabled) {
+  int index = indexOf(CAPABILITIES, N_CAPABILITIES, capability);
+  if (index < 0) {
+    COUNTERS.issued++;
+  } else if (!change(SHADOW.capabilities[index], enabled)) {
+    return;
+  }
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+
+}  // namespace
+
+void useProgram(GLuint program) {
+  if (change(SHADOW.program, program)) {
+    glUseProgram(program);
+  }
+}
+
+void bindVertexArray(GLuint vao) {
+  if (change(SHADOW.vao, vao)) {
+    glBindVertexArray(vao);
+    SHADOW.buffers[indexOf(BUFFER_TARGETS, N_BUFFER_TARGETS,
+                           GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+  }
+}
+
+void bindBuffer(GLenum target, GLuint buffer) {
+  int index = indexOf(BUFFER_TARGETS, N_BUFFER_TARGETS, target);
+  if (index < 0) {
+    COUNTERS.issued++;
+  } else if (!change(SHADOW.buffers[index], buffer)) {
+    return;
+  }
+  glBindBuffer(target, buffer);
+}
+
+void activeTexture(GLenum unit) {
+  if (change(SHADOW.active_texture, unit)) {
+    glActiveTexture(unit);
+  }
+}
+
+void bindTexture(GLenum target, GLuint texture) {
+  int unit = (int)(SHADOW.active_texture - GL_TEXTURE0);
+  int index = indexOf(TEXTURE_TARGETS, N_TEXTURE_TARGETS, target);
+  if (SHADOW.active_texture == UNKNOWN || unit >= MAX_TEXTURE_UNITS ||
+      index < 0) {
+    COUNTERS.issued++;
+  } else if (!change(SHADOW.textures[unit][index], texture)) {
+    return;
+  }
+  glBindTexture(target, texture);
+}
+
+void bindTextureUnit(int unit, GLenum target, GLuint texture) {
+  activeTexture(GL_TEXTURE0 + unit);
+  bindTexture(target, texture);
+}
+
+void enable(GLenum capability) {
+  setCapability(capability, GL_TRUE);
+}
+
+void disable(GLenum capability) {
+  setCapability(capability, GL_FALSE);
+}
+
+void depthFunc(GLenum func) {
+  if (change(SHADOW.depth_func, func)) {
+    glDepthFunc(func);
+  }
+}
+
+void depthMask(GLboolean write) {
+  if (change(SHADOW.depth_mask, write)) {
+    glDepthMask(write);
+  }
+}
+
+void blendFunc(GLenum source, GLenum destination) {
+  if (SHADOW.blend_source == source &&
+      SHADOW.blend_destination == destination) {
+    COUNTERS.elided++;
+    return;
+  }
+  SHADOW.blend_source = source;
+  SHADOW.blend_destination = destination;
+  COUNTERS.issued++;
+  glBlendFunc(source, destination);
+}
+
+void colorMask(GLboolean red,
+               GLboolean green,
+               GLboolean blue,
+               GLboolean alpha) {
+  GLuint bits = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) |
+                (alpha ? 8 : 0);
+  if (change(SHADOW.color_mask, bits)) {
+    glColorMask(red, green, blue, alpha);
+  }
+}
+
+void programDeleted(GLuint program) {
+  forget(SHADOW.program, program);
+}
+
+void vertexArrayDeleted(GLuint vao) {
+  if (SHADOW.vao == vao) {
+    // GL reverts to VAO 0, which has its own element buffer binding
+    SHADOW.vao = 0;
+    SHADOW.buffers[indexOf(BUFFER_TARGETS, N_BUFFER_TARGETS,
+                           GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+  }
+}
+
+void bufferDeleted(GLuint buffer) {
+  for (GLuint& bound : SHADOW.buffers) {
+    if (bound == buffer) {
+      bound = 0;
+    }
+  }
+}
+
+void textureDeleted(GLuint texture) {
+  for (GLuint(&unit)[N_TEXTURE_TARGETS] : SHADOW.textures) {
+    for (GLuint& bound : unit) {
+      if (bound == texture) {
+        bound = 0;
+      }
+    }
+  }
+}
+
+void invalidate() {
+  SHADOW = unknownShadow();
+}
+
+const Counters& counters() {
+  return COUNTERS;
+}
+
+void resetCounters() {
+  COUNTERS = Counters();
+}
+
+}  // namespace gl_state
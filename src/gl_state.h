@@ -0,0 +1,62 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the GL state the renderer changes most: bound program,
+// VAO, buffers, textures per unit, and depth, blend and color write state.
+// Each setter compares against the shadow and skips the GL call when it
+// would change nothing. Calls for targets or capabilities not shadowed here
+// are always issued.
+//
+// The shadow starts out unknown, so the first call of each kind is always
+// issued. Code that changes tracked state behind the tracker's back must
+// call invalidate() afterwards. One tracker per process, for the one
+// context the renderer draws with.
+namespace gl_state {
+
+// Highest texture unit tracked, exclusive
+const int MAX_TEXTURE_UNITS = 16;
+
+// Calls made through the tracker since the last resetCounters()
+struct Counters {
+  int issued = 0;
+  int elided = 0;
+};
+
+void useProgram(GLuint program);
+void bindVertexArray(GLuint vao);
+// The GL_ELEMENT_ARRAY_BUFFER binding belongs to the VAO; it is forgotten
+// whenever the VAO changes.
+void bindBuffer(GLenum target, GLuint buffer);
+// |unit| is GL_TEXTURE0 + n
+void activeTexture(GLenum unit);
+// Binds to the active unit
+void bindTexture(GLenum target, GLuint texture);
+// activeTexture(GL_TEXTURE0 + unit) then bindTexture(target, texture)
+void bindTextureUnit(int unit, GLenum target, GLuint texture);
+
+// GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST
+void enable(GLenum capability);
+void disable(GLenum capability);
+void depthFunc(GLenum func);
+void depthMask(GLboolean write);
+void blendFunc(GLenum source, GLenum destination);
+void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+
+// Deleting an object the shadow has bound; GL unbinds it (or, for a program
+// in use, frees its name once unbound) so the shadow must forget it
+void programDeleted(GLuint program);
+void vertexArrayDeleted(GLuint vao);
+void bufferDeleted(GLuint buffer);
+void textureDeleted(GLuint texture);
+
+// Forgets every shadowed value
+void invalidate();
+
+const Counters& counters();
+void resetCounters();
+
+}  // namespace gl_state
+
+#endif
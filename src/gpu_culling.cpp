@@ -0,0 +1,85 @@
+#include "gpu_culling.h"
+
+#include <vector>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+
+namespace {
+
+const char* const CULL_SHADER_PATH = "src/shaders/compute/cull.comp";
+// local_size_x of the shader
+const int GROUP_SIZE = 64;
+
+// std430 layout of Cube in the shader
+struct GpuCube {
+  glm::vec4 position_radius;
+  glm::vec4 axis_speed;
+};
+static_assert(sizeof(GpuCube) == 32, "GpuCube must match the std430 Cube");
+
+}  // namespace
+
+GpuCuller::GpuCuller(const CubeScene& scene,
+                     int n_indices,
+                     unsigned int instance_buffer)
+    : program_(CULL_SHADER_PATH),
+      n_cubes_(scene.size()),
+      n_indices_(n_indices),
+      instance_buffer_(instance_buffer) {
+  n_cubes_uniform_ = program_.uniform("n_cubes");
+  planes_uniform_ = program_.uniform("planes");
+  time_uniform_ = program_.uniform("time");
+
+  std::vector<GpuCube> cubes(n_cubes_);
+  for (int i = 0; i < n_cubes_; i++) {
+    cubes[i].position_radius = glm::vec4(scene.position(i), CUBE_RADIUS);
+    cubes[i].axis_speed = glm::vec4(scene.axis(i), scene.speed[i]);
+  }
+  glGenBuffers(1, &cube_buffer_);
+  gl_state::bindBuffer(GL_SHADER_STORAGE_BUFFER, cube_buffer_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, cubes.size() * sizeof(GpuCube),
+               cubes.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &command_buffer_);
+  gl_state::bindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               sizeof(gl_ext::DrawElementsIndirectCommand), NULL,
+               GL_DYNAMIC_DRAW);
+}
+
+GpuCuller::~GpuCuller() {
+  glDeleteBuffers(1, &cube_buffer_);
+  glDeleteBuffers(1, &command_buffer_);
+  gl_state::bufferDeleted(cube_buffer_);
+  gl_state::bufferDeleted(command_buffer_);
+  program_.Delete();
+}
+
+void GpuCuller::cull(const Frustum& frustum, float time) {
+  // the whole mesh, no instances yet
+  const gl_ext::DrawElementsIndirectCommand reset = {(GLuint)n_indices_, 0,
+                                                     0, 0, 0};
+  gl_state::bindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer_);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(reset), &reset);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, cube_buffer_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instance_buffer_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, command_buffer_);
+
+  program_.use();
+  glUniform1ui(n_cubes_uniform_.location, (GLuint)n_cubes_);
+  program_.set_vec4(planes_uniform_, frustum.planes, 6);
+  program_.set_float(time_uniform_, time);
+  gl_ext::DispatchCompute((n_cubes_ + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+  // the draw reads the command and the matrices the pass wrote, and the
+  // next frame's glBufferSubData() overwrites the instance count it added to
+  gl_ext::MemoryBarrierGL(GL_COMMAND_BARRIER_BIT |
+                          GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                          GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void GpuCuller::draw() {
+  gl_state::bindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_);
+  gl_ext::DrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL);
+}
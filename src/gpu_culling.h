@@ -0,0 +1,43 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include "frustum.h"
+#include "scene.h"
+#include "shader.h"
+
+// Frustum culling and draw compaction on the GPU. A compute pass tests every
+// cube's bounding sphere and appends the model matrix of each survivor to
+// the instance buffer, bumping the instance count of an indirect draw
+// command with an atomic. The draw then consumes that command directly, so
+// the CPU does constant work per frame and never reads anything back.
+// Needs GL 4.3 (gl_ext::hasComputeShader()).
+class GpuCuller {
+ public:
+  // Uploads the static cube data. Each survivor is an instance of a mesh of
+  // |n_indices| GL_UNSIGNED_INT indices. |instance_buffer| receives the
+  // matrices and must hold scene.size() mat4s.
+  GpuCuller(const CubeScene& scene,
+            int n_indices,
+            unsigned int instance_buffer);
+  ~GpuCuller();
+  GpuCuller(const GpuCuller&) = delete;
+  GpuCuller& operator=(const GpuCuller&) = delete;
+
+  // Dispatches the culling pass for cubes at |time| seconds. Leaves the
+  // compute program bound.
+  void cull(const Frustum& frustum, float time);
+  // Draws the survivors of the last cull() as instances of the cube with
+  // the caller's program and VAO, whose element buffer holds the mesh
+  void draw();
+
+ private:
+  Shader program_;
+  Shader::Uniform n_cubes_uniform_, planes_uniform_, time_uniform_;
+  int n_cubes_;
+  int n_indices_;
+  unsigned int cube_buffer_ = 0;
+  unsigned int command_buffer_ = 0;
+  unsigned int instance_buffer_;
+};
+
+#endif
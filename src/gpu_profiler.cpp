@@ -0,0 +1,130 @@
+#include "gpu_profiler.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// Bounds the result queue when nobody pops
+static const size_t MAX_RESULTS = 1024;
+
+GpuProfiler::GpuProfiler() {
+  for (QuerySet& set : sets_) {
+    glGenQueries(2 * MAX_PASSES, set.queries);
+  }
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (QuerySet& set : sets_) {
+    glDeleteQueries(2 * MAX_PASSES, set.queries);
+  }
+}
+
+void GpuProfiler::beginFrame(int frame) {
+  collect(false);
+  QuerySet& set = sets_[next_];
+  if (set.pending) {
+    // the GPU is FRAME_LATENCY frames behind; skip rather than wait
+    current_ = NULL;
+    return;
+  }
+  current_ = &set;
+  set.frame = frame;
+  set.n_passes = 0;
+  set.n_open = 0;
+}
+
+void GpuProfiler::endFrame() {
+  if (!current_) {
+    return;
+  }
+  while (current_->n_open > 0) {
+    endPass();
+  }
+  if (current_->n_passes > 0) {
+    current_->pending = true;
+    next_ = (next_ + 1) % FRAME_LATENCY;
+  }
+  current_ = NULL;
+}
+
+void GpuProfiler::beginPass(const char* name) {
+  if (!current_ || current_->n_passes == MAX_PASSES) {
+    return;
+  }
+  int pass = current_->n_passes++;
+  current_->names[pass] = name;
+  current_->open[current_->n_open++] = pass;
+  glQueryCounter(current_->queries[2 * pass], GL_TIMESTAMP);
+}
+
+void GpuProfiler::endPass() {
+  if (!current_ || current_->n_open == 0) {
+    return;
+  }
+  int pass = current_->open[--current_->n_open];
+  current_->last_query = current_->queries[2 * pass + 1];
+  glQueryCounter(current_->last_query, GL_TIMESTAMP);
+}
+
+double GpuProfiler::passMs(const char* name) const {
+  for (const PassTiming& pass : latest_.passes) {
+    if (std::strcmp(pass.name, name) == 0) {
+      return pass.ms;
+    }
+  }
+  return -1.0;
+}
+
+bool GpuProfiler::popResult(FrameTiming& timing) {
+  if (results_.empty()) {
+    return false;
+  }
+  timing = std::move(results_.front());
+  results_.pop_front();
+  return true;
+}
+
+void GpuProfiler::flush() {
+  collect(true);
+}
+
+void GpuProfiler::collect(bool wait) {
+  while (sets_[oldest_].pending) {
+    QuerySet& set = sets_[oldest_];
+    // timestamps land in submission order, so the last one implies the rest
+    unsigned int last = set.last_query;
+    if (!wait) {
+      int available = GL_FALSE;
+      glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) {
+        return;
+      }
+    }
+
+    FrameTiming timing;
+    timing.frame = set.frame;
+    GLuint64 first_ns = 0, last_ns = 0;
+    for (int pass = 0; pass < set.n_passes; pass++) {
+      GLuint64 begin_ns = 0, end_ns = 0;
+      glGetQueryObjectui64v(set.queries[2 * pass], GL_QUERY_RESULT, &begin_ns);
+      glGetQueryObjectui64v(set.queries[2 * pass + 1], GL_QUERY_RESULT,
+                            &end_ns);
+      timing.passes.push_back({set.names[pass], (end_ns - begin_ns) / 1e6});
+      if (pass == 0 || begin_ns < first_ns) {
+        first_ns = begin_ns;
+      }
+      if (end_ns > last_ns) {
+        last_ns = end_ns;
+      }
+    }
+    timing.total_ms = (last_ns - first_ns) / 1e6;
+
+    latest_ = timing;
+    results_.push_back(std::move(timing));
+    if (results_.size() > MAX_RESULTS) {
+      results_.pop_front();
+    }
+    set.pending = false;
+    oldest_ = (oldest_ + 1) % FRAME_LATENCY;
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// GPU timings of named passes within a frame, from GL_TIMESTAMP queries.
+// Each frame writes into one of FRAME_LATENCY query sets and results are
+// read back when they are available, several frames later. Nothing here ever
+// waits on the GPU except flush(). If the GPU falls FRAME_LATENCY frames
+// behind, the newest frame goes unprofiled instead.
+class GpuProfiler {
+ public:
+  // Query sets in flight
+  static const int FRAME_LATENCY = 4;
+  // Passes per frame; further passes are ignored
+  static const int MAX_PASSES = 16;
+
+  struct PassTiming {
+    // The literal given to beginPass()
+    const char* name;
+    double ms;
+  };
+  struct FrameTiming {
+    int frame = -1;
+    // First beginPass() to last endPass()
+    double total_ms = 0.0;
+    std::vector<PassTiming> passes;
+  };
+
+  GpuProfiler();
+  ~GpuProfiler();
+
+  // Brackets a frame. Collects whatever results have arrived.
+  void beginFrame(int frame);
+  void endFrame();
+  // Brackets a pass. |name| must outlive the profiler (use a literal).
+  // Passes may nest.
+  void beginPass(const char* name);
+  void endPass();
+
+  // Most recently completed frame; frame is -1 until there is one
+  const FrameTiming& latest() const { return latest_; }
+  // Latest time of pass |name| in ms, or -1 if it has no result yet
+  double passMs(const char* name) const;
+  // Takes the oldest completed frame not yet popped. Returns false if none.
+  bool popResult(FrameTiming& timing);
+  // Blocks until every submitted frame has completed
+  void flush();
+
+ private:
+  struct QuerySet {
+    int frame = -1;
+    bool pending = false;
+    int n_passes = 0;
+    const char* names[MAX_PASSES];
+    // begin and end timestamp of each pass
+    unsigned int queries[2 * MAX_PASSES];
+    // stack of passes still open
+    int open[MAX_PASSES];
+    int n_open = 0;
+    // The query endPass() issued last. With nested passes that is an outer
+    // pass's end, not the end of the last pass to begin.
+    unsigned int last_query = 0;
+  };
+
+  // Reads finished sets in submission order, blocking if |wait|
+  void collect(bool wait);
+
+  QuerySet sets_[FRAME_LATENCY];
+  // Set being recorded, or NULL when this frame is skipped
+  QuerySet* current_ = NULL;
+  // Next set to read back
+  int oldest_ = 0;
+  // Next set to record into
+  int next_ = 0;
+  FrameTiming latest_;
+  std::deque<FrameTiming> results_;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "headless.h"
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "gl_ext.h"
+
+#ifdef LEARNOPENGL_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace headless {
+
+#ifdef LEARNOPENGL_HEADLESS
+
+namespace {
+
+EGLDisplay DISPLAY = EGL_NO_DISPLAY;
+EGLContext CONTEXT = EGL_NO_CONTEXT;
+EGLSurface SURFACE = EGL_NO_SURFACE;
+unsigned int FBO = 0;
+unsigned int COLOR_RBO = 0;
+unsigned int DEPTH_RBO = 0;
+int WIDTH = 0;
+int HEIGHT = 0;
+
+bool hasEglExtension(EGLDisplay display, const char* name) {
+  const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+  if (!extensions) {
+    return false;
+  }
+  std::string_view list(extensions);
+  std::string_view needle(name);
+  size_t pos = 0;
+  while ((pos = list.find(needle, pos)) != std::string_view::npos) {
+    size_t end = pos + needle.size();
+    if ((pos == 0 || list[pos - 1] == ' ') &&
+        (end == list.size() || list[end] == ' ')) {
+      return true;
+    }
+    pos = end;
+  }
+  return false;
+}
+
+EGLDisplay openDisplay() {
+  // prefer a display that needs neither X11 nor Wayland
+  if (hasEglExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+      EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                              EGL_DEFAULT_DISPLAY, NULL);
+      if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+        return display;
+      }
+    }
+  }
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+    return display;
+  }
+  return EGL_NO_DISPLAY;
+}
+
+}  // namespace
+
+bool setup(int width, int height) {
+  DISPLAY = openDisplay();
+  if (DISPLAY == EGL_NO_DISPLAY) {
+    std::cout << "Failed to initialize an EGL display" << std::endl;
+    return false;
+  }
+
+  bool surfaceless = hasEglExtension(DISPLAY, "EGL_KHR_surfaceless_context");
+  EGLint config_attributes[] = {
+      EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_RED_SIZE, 8,
+      EGL_GREEN_SIZE, 8,
+      EGL_BLUE_SIZE, 8,
+      EGL_NONE};
+  EGLConfig config;
+  EGLint n_configs = 0;
+  if (!eglChooseConfig(DISPLAY, config_attributes, &config, 1, &n_configs) ||
+      n_configs == 0) {
+    std::cout << "No suitable EGL config" << std::endl;
+    teardown();
+    return false;
+  }
+
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint context_attributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 3,
+      EGL_CONTEXT_MINOR_VERSION, 3,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE};
+  CONTEXT = eglCreateContext(DISPLAY, config, EGL_NO_CONTEXT,
+                             context_attributes);
+  if (CONTEXT == EGL_NO_CONTEXT) {
+    std::cout << "Failed to create an EGL OpenGL 3.3 context" << std::endl;
+    teardown();
+    return false;
+  }
+
+  if (!surfaceless) {
+    // nothing is ever drawn to it; it only satisfies eglMakeCurrent
+    EGLint pbuffer_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    SURFACE = eglCreatePbufferSurface(DISPLAY, config, pbuffer_attributes);
+  }
+  if (!eglMakeCurrent(DISPLAY, SURFACE, SURFACE, CONTEXT)) {
+    std::cout << "Failed to make the EGL context current" << std::endl;
+    teardown();
+    return false;
+  }
+
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    teardown();
+    return false;
+  }
+  gl_ext::load((GLADloadproc)eglGetProcAddress);
+
+  // everything renders into this framebuffer instead of a window
+  WIDTH = width;
+  HEIGHT = height;
+  glGenFramebuffers(1, &FBO);
+  glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+  glGenRenderbuffers(1, &COLOR_RBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, COLOR_RBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, COLOR_RBO);
+  glGenRenderbuffers(1, &DEPTH_RBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, DEPTH_RBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, DEPTH_RBO);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "Headless framebuffer is incomplete" << std::endl;
+    teardown();
+    return false;
+  }
+  glViewport(0, 0, width, height);
+
+  std::cout << "Headless: " << glGetString(GL_RENDERER) << ", OpenGL "
+            << glGetString(GL_VERSION) << std::endl;
+  return true;
+}
+
+bool saveScreenshot(const char* path) {
+  if (FBO == 0) {
+    return false;
+  }
+  std::vector<unsigned char> pixels(WIDTH * HEIGHT * 3);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+  FILE* file = std::fopen(path, "wb");
+  if (!file) {
+    std::cout << "Failed to open " << path << std::endl;
+    return false;
+  }
+  std::fprintf(file, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+  // GL rows go bottom-up, PPM rows top-down
+  for (int y = HEIGHT - 1; y >= 0; y--) {
+    std::fwrite(&pixels[y * WIDTH * 3], 1, WIDTH * 3, file);
+  }
+  std::fclose(file);
+  return true;
+}
+
+void teardown() {
+  if (CONTEXT != EGL_NO_CONTEXT && FBO != 0) {
+    glDeleteRenderbuffers(1, &COLOR_RBO);
+    glDeleteRenderbuffers(1, &DEPTH_RBO);
+    glDeleteFramebuffers(1, &FBO);
+    FBO = COLOR_RBO = DEPTH_RBO = 0;
+  }
+  if (DISPLAY != EGL_NO_DISPLAY) {
+    eglMakeCurrent(DISPLAY, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (CONTEXT != EGL_NO_CONTEXT) {
+      eglDestroyContext(DISPLAY, CONTEXT);
+    }
+    if (SURFACE != EGL_NO_SURFACE) {
+      eglDestroySurface(DISPLAY, SURFACE);
+    }
+    eglTerminate(DISPLAY);
+  }
+  DISPLAY = EGL_NO_DISPLAY;
+  CONTEXT = EGL_NO_CONTEXT;
+  SURFACE = EGL_NO_SURFACE;
+}
+
+#else
+
+bool setup(int width, int height) {
+  std::cout << "Headless mode needs EGL; this build has none" << std::endl;
+  return false;
+}
+
+bool saveScreenshot(const char* path) {
+  return false;
+}
+
+void teardown() {}
+
+#endif
+
+}  // namespace headless
@@ -0,0 +1,23 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Offscreen rendering for machines without a display or GPU: an EGL context
+// on Mesa's surfaceless platform (or a pbuffer when that is unavailable)
+// drawing into a framebuffer object. Mesa's llvmpipe is sufficient.
+// Only functional when built with LEARNOPENGL_HEADLESS (EGL found by CMake).
+namespace headless {
+
+// Creates the context, loads GL and binds a width x height FBO with color and
+// depth attachments. Returns false, after printing why, on failure.
+bool setup(int width, int height);
+
+// Writes the FBO's color attachment to a binary PPM. Returns false on
+// failure.
+bool saveScreenshot(const char* path);
+
+// Releases the FBO and the context
+void teardown();
+
+}  // namespace headless
+
+#endif
@@ -0,0 +1,174 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "profiler.h"
+
+namespace {
+
+uint64_t packRange(int begin, int end) {
+  return (uint64_t)(uint32_t)begin | (uint64_t)(uint32_t)end << 32;
+}
+
+int rangeBegin(uint64_t range) {
+  return (int)(uint32_t)range;
+}
+
+int rangeEnd(uint64_t range) {
+  return (int)(uint32_t)(range >> 32);
+}
+
+}  // namespace
+
+JobSystem::Deque::Deque() : top_(0), bottom_(0) {
+  for (std::atomic<uint64_t>& range : ranges_) {
+    range.store(0, std::memory_order_relaxed);
+  }
+}
+
+void JobSystem::Deque::push(uint64_t range) {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  assert(bottom - top_.load(std::memory_order_acquire) < CAPACITY);
+  ranges_[bottom & (CAPACITY - 1)].store(range, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+bool JobSystem::Deque::pop(uint64_t* range) {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+  bottom_.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  if (top > bottom) {
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return false;
+  }
+  *range = ranges_[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // the last entry: race the thieves for it
+    bool won = top_.compare_exchange_strong(top, top + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+bool JobSystem::Deque::steal(uint64_t* range) {
+  int64_t top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t bottom = bottom_.load(std::memory_order_acquire);
+  if (top >= bottom) {
+    return false;
+  }
+  *range = ranges_[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  return top_.compare_exchange_strong(top, top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed);
+}
+
+JobSystem::JobSystem(int threads) : body_(NULL), grain_(1), remaining_(0) {
+  if (threads <= 0) {
+    threads = (int)std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < threads; i++) {
+    deques_.push_back(std::make_unique<Deque>());
+  }
+  // deque 0 is the owner's
+  for (int i = 1; i < threads; i++) {
+    workers_.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void JobSystem::workerLoop(int self) {
+  profiler::setThreadName("jobs");
+  unsigned int seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+      if (quit_) {
+        return;
+      }
+      seen = generation_;
+    }
+    work(self);
+  }
+}
+
+void JobSystem::parallelFor(int begin, int end, int grain, const Body& body) {
+  if (end <= begin) {
+    return;
+  }
+  grain = std::max(1, grain);
+  if (workers_.empty() || end - begin <= grain) {
+    body(begin, end);
+    return;
+  }
+  grain_.store(grain, std::memory_order_relaxed);
+  remaining_.store(end - begin, std::memory_order_relaxed);
+  body_.store(&body, std::memory_order_release);
+  deques_[0]->push(packRange(begin, end));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+  }
+  wake_.notify_all();
+  work(0);
+}
+
+void JobSystem::work(int self) {
+  Deque& own = *deques_[self];
+  // xorshift state picking the first victim to try
+  uint32_t random = 2654435761u * (uint32_t)(self + 1);
+  const int n = threads();
+  while (remaining_.load(std::memory_order_acquire) > 0) {
+    uint64_t range;
+    if (own.pop(&range)) {
+      run(self, range);
+      continue;
+    }
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    bool stolen = false;
+    for (int i = 0, victim = random % n; i < n && !stolen;
+         i++, victim = (victim + 1) % n) {
+      stolen = victim != self && deques_[victim]->steal(&range);
+    }
+    if (stolen) {
+      run(self, range);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::run(int self, uint64_t range) {
+  int begin = rangeBegin(range);
+  int end = rangeEnd(range);
+  const int grain = grain_.load(std::memory_order_relaxed);
+  while (end - begin > grain) {
+    // split between grains, so every subrange starts a whole number of
+    // grains into the loop
+    int grains = (end - begin + grain - 1) / grain;
+    int middle = begin + grains / 2 * grain;
+    deques_[self]->push(packRange(middle, end));
+    end = middle;
+  }
+  (*body_.load(std::memory_order_acquire))(begin, end);
+  remaining_.fetch_sub(end - begin, std::memory_order_acq_rel);
+}
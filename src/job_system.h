@@ -0,0 +1,90 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for data-parallel loops over index ranges.
+//
+// Every thread, the owner included, has a Chase-Lev deque of subranges. A
+// thread splits the range it holds in halves at a grain boundary, pushing
+// the upper half to the bottom of its deque, until it is at most the grain
+// size, then runs it and pops the next. Idle threads steal from the top of
+// a random victim's deque, so they take the largest pieces left and split
+// them in turn.
+//
+// parallelFor() is called from the thread that created the JobSystem only,
+// one loop at a time; the body must not call it again.
+class JobSystem {
+ public:
+  // The body of a loop, run on subranges [begin, end)
+  typedef std::function<void(int begin, int end)> Body;
+
+  // |threads| run loops, the caller included; 0 means one per hardware
+  // thread
+  explicit JobSystem(int threads = 0);
+  ~JobSystem();
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  int threads() const { return (int)deques_.size(); }
+
+  // Runs |body| over [begin, end) split into subranges of |grain| indices,
+  // the last one possibly shorter, and returns when all have finished. A
+  // grain that is a multiple of the SIMD width keeps every subrange but the
+  // last free of scalar tails.
+  void parallelFor(int begin, int end, int grain, const Body& body);
+
+ private:
+  // Chase & Lev's deque, after Le et al., "Correct and Efficient
+  // Work-Stealing for Weak Memory Models" (2013). Its owner pushes and pops
+  // at the bottom, any thread steals from the top. Fixed capacity: a range
+  // split in halves leaves at most one entry per halving on the deque.
+  class Deque {
+   public:
+    static const int CAPACITY = 64;
+
+    Deque();
+    void push(uint64_t range);
+    // False when empty
+    bool pop(uint64_t* range);
+    // False when empty or another thread won the race for the top entry
+    bool steal(uint64_t* range);
+
+   private:
+    // top_ and bottom_ on their own cache lines; thieves only write top_
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<uint64_t> ranges_[CAPACITY];
+  };
+
+  // Splits and runs ranges from thread |self|'s deque and other threads'
+  // until the loop has finished
+  void work(int self);
+  // Runs |range|, pushing all but its first grain to |self|'s deque
+  void run(int self, uint64_t range);
+  void workerLoop(int self);
+
+  std::vector<std::unique_ptr<Deque>> deques_;
+  std::vector<std::thread> workers_;
+
+  // The running loop
+  std::atomic<const Body*> body_;
+  std::atomic<int> grain_;
+  // Indices of the loop not yet run; the loop has finished at 0
+  std::atomic<int64_t> remaining_;
+
+  // Idle workers sleep until the next loop
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  unsigned int generation_ = 0;
+  bool quit_ = false;
+};
+
+#endif
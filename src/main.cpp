@@ -2,24 +2,53 @@
 #include <glad/glad.h>
 ////////////// line here for linter glad.h must be first
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
-#include <ctime>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <vector>
 
+#include "benchmark.h"
+#include "bvh.h"
 #include "camera.h"
 #include "constants.h"
+#include "frame_uniforms.h"
+#include "frame_pacer.h"
+#include "frustum.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "gpu_culling.h"
+#include "gpu_profiler.h"
+#include "headless.h"
+#include "job_system.h"
+#include "mesh.h"
+#include "occlusion.h"
+#include "occlusion_queries.h"
+#include "options.h"
+#include "profiler.h"
+#include "program_cache.h"
+#include "render_queue.h"
+#include "scene.h"
 #include "shader.h"
+#include "shader_compiler.h"
+#include "stream_buffer.h"
+#include "transforms.h"
+#include "vertex_format.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 GLFWwindow* WINDOW;
+Options OPTIONS;
 // Camera starting position
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -35,8 +64,20 @@ float last_y = constants::HEIGHT / 2.f;
 float delta_time = 0.0f;
 float last_time = 0.0f;
 
+// Frames presented so far
+int FRAME = 0;
+// Current framebuffer size
+int FRAMEBUFFER_WIDTH = constants::WIDTH;
+int FRAMEBUFFER_HEIGHT = constants::HEIGHT;
+const auto START_TIME = std::chrono::steady_clock::now();
+// Cubes per job of the parallel per-cube updates, enough to amortize a
+// steal. Fewer visible cubes are updated on the render thread alone.
+const int UPDATE_GRAIN = 1024;
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
   glViewport(0, 0, width, height);
+  FRAMEBUFFER_WIDTH = width;
+  FRAMEBUFFER_HEIGHT = height;
 }
 
 void mouseCallback(GLFWwindow* window, double x, double y) {
@@ -57,10 +98,6 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
   camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-float random_real(float x = 1) {
-  return x * std::rand() / RAND_MAX;
-}
-
 void windowSetup() {
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -80,6 +117,7 @@ void windowSetup() {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return exit(-1);
   }
+  gl_ext::load((GLADloadproc)glfwGetProcAddress);
 
   glViewport(0, 0, constants::WIDTH, constants::HEIGHT);
 
@@ -91,7 +129,47 @@ void windowSetup() {
   glfwSetInputMode(WINDOW, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
 
+// Seconds since startup. Headless runs have no GLFW, so use the steady clock.
+float currentTime() {
+  if (OPTIONS.headless) {
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                        START_TIME)
+        .count();
+  }
+  return glfwGetTime();
+}
+
+// |benchmark| is NULL unless benchmarking; it decides when the run ends
+bool shouldClose(const FrameBenchmark* benchmark) {
+  if (benchmark ? benchmark->done()
+                : OPTIONS.frames > 0 && FRAME >= OPTIONS.frames) {
+    return true;
+  }
+  return !OPTIONS.headless && glfwWindowShouldClose(WINDOW);
+}
+
+// Shows the finished frame. Headless frames stay in the FBO; flushing keeps
+// the GPU busy instead of letting commands pile up.
+void presentFrame() {
+  FRAME++;
+  if (OPTIONS.headless) {
+    PROFILE_ZONE("glFlush");
+    glFlush();
+    return;
+  }
+  {
+    PROFILE_ZONE("glfwPollEvents");
+    glfwPollEvents();
+  }
+  PROFILE_ZONE("glfwSwapBuffers");
+  glfwSwapBuffers(WINDOW);
+}
+
 void processInput(float delta_time) {
+  PROFILE_ZONE("processInput");
+  if (OPTIONS.headless) {
+    return;
+  }
   if (glfwGetKey(WINDOW, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
     glfwSetWindowShouldClose(WINDOW, true);
   }
@@ -110,11 +188,55 @@ void processInput(float delta_time) {
 }
 
 void renderTexture() {
-  const char* vertex_shader_fp = "src/shaders/vertex/vertex.vs";
+  if (OPTIONS.render_mode == MULTI_DRAW_INDIRECT &&
+      !gl_ext::hasMultiDrawIndirect()) {
+    std::cout << "Multi-draw indirect needs GL 4.3, drawing per cube instead"
+              << std::endl;
+    OPTIONS.render_mode = PER_DRAW;
+  }
+  if (OPTIONS.render_mode == GPU_CULL && !gl_ext::hasComputeShader()) {
+    std::cout << "GPU culling needs GL 4.3, culling on the CPU instead"
+              << std::endl;
+    OPTIONS.render_mode = INSTANCED;
+  }
+  if (OPTIONS.render_mode == VERTEX_PULLING) {
+    // two RGBA32F texels per cube in each frame's region of the buffer
+    // texture, plus the regions' 256 byte alignment. GL 3.3 guarantees only
+    // 65536 texels; texelFetch() past the limit returns zeros.
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    long long texels =
+        (long long)OPTIONS.frames_in_flight * (2LL * OPTIONS.n_cubes + 16);
+    if (texels > max_texels) {
+      std::cout << "Vertex pulling needs " << texels
+                << " buffer texture texels, more than the " << max_texels
+                << " supported; drawing instanced instead" << std::endl;
+      OPTIONS.render_mode = INSTANCED;
+    }
+  }
+  // modes that read model matrices from the instance buffer
+  const bool instance_matrices = OPTIONS.render_mode == INSTANCED ||
+                                 OPTIONS.render_mode == MULTI_DRAW_INDIRECT ||
+                                 OPTIONS.render_mode == GPU_CULL;
+  // the cube is generated in the vertex shader, which needs no buffers but
+  // the per-instance data
+  const bool pulled = OPTIONS.render_mode == VERTEX_PULLING;
+  // the cubes never change on the CPU after setup
+  const bool animated = OPTIONS.render_mode == GPU_ANIMATED;
+
+  const char* vertex_shader_fp = pulled ? "src/shaders/vertex/pulled.vs"
+                                        : "src/shaders/vertex/vertex.vs";
   const char* fragment_shader_fp = "src/shaders/fragment/texture.frag";
-  Shader texture_shader(vertex_shader_fp, fragment_shader_fp);
+  const char* fallback_shader_fp = "src/shaders/fragment/fallback.frag";
+  // Submit every program up front; they compile in the background while the
+  // cubes are drawn with a flat-colored fallback built synchronously
+  ShaderCompiler shader_compiler;
+  ShaderCompiler::Handle texture_program =
+      shader_compiler.submit(vertex_shader_fp, fragment_shader_fp);
+  Shader fallback_shader(vertex_shader_fp, fallback_shader_fp);
+  program_cache::printStats();
 
-  std::srand(std::time(NULL));
+  std::srand(OPTIONS.seed);
 
   float vertices[] = {
       -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 0.0f,
@@ -140,29 +262,156 @@ void renderTexture() {
       -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f,
       0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
       -0.5f, 0.5f,  0.5f,  0.0f, 0.0f, -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f};
-  // world space positions of our cubes
-  glm::vec3 cubePositions[] = {
-      glm::vec3(0.0f, 0.0f, 0.0f),    glm::vec3(2.0f, 5.0f, -15.0f),
-      glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
-      glm::vec3(2.4f, -0.4f, -3.5f),  glm::vec3(-1.7f, 3.0f, -7.5f),
-      glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
-      glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f)};
-  unsigned int VBO, VAO;
+  // 36 corners of 12 triangles, only 16 of them distinct (several faces
+  // share texture coordinates): index them into an element buffer in vertex
+  // cache friendly order
+  MeshStats cube_stats;
+  const IndexedMesh cube = buildIndexedMesh(
+      vertices, sizeof(vertices) / (5 * sizeof(float)), 5, &cube_stats);
+  const GLsizei cube_indices = (GLsizei)cube.indices.size();
+  // position (location 0) and texture coordinates (location 1), packed as
+  // --vertex-format asks
+  VertexFormat cube_format;
+  switch (OPTIONS.vertex_format) {
+    case VERTEX_FLOAT:
+      cube_format.attributes = {{0, 3, ATTRIBUTE_FLOAT},
+                                {1, 2, ATTRIBUTE_FLOAT}};
+      break;
+    case VERTEX_HALF:
+      cube_format.attributes = {{0, 3, ATTRIBUTE_HALF},
+                                {1, 2, ATTRIBUTE_UNORM16}};
+      break;
+    case VERTEX_SNORM16:
+      cube_format.attributes = {{0, 3, ATTRIBUTE_SNORM16},
+                                {1, 2, ATTRIBUTE_UNORM16}};
+      break;
+  }
+  const std::vector<unsigned char> cube_vertices = packVertices(
+      cube_format, cube.vertices.data(), cube.vertexCount());
+  // vertices the GPU fetches per cube drawn, going by the cache simulation
+  const float cube_fetch_bytes =
+      pulled ? 0.0f
+             : cube_stats.acmr_after * cube_stats.triangles *
+                   cube_format.stride();
+  std::cout << "Cube mesh: " << cube_stats.input_vertices << " -> "
+            << cube_stats.unique_vertices << " vertices of "
+            << cube_format.stride() << " bytes ("
+            << vertexPackingName(OPTIONS.vertex_format) << "), ACMR "
+            << cube_stats.acmr_before << " -> " << cube_stats.acmr_after
+            << std::endl;
+
+  // positions, rotation axes and speeds of our cubes
+  const CubeScene scene = makeCubeScene(OPTIONS.n_cubes);
+  const int n_cubes = scene.size();
+
+  unsigned int VBO, EBO, VAO, instanceVBO;
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
+  glGenBuffers(1, &EBO);
+  glGenBuffers(1, &instanceVBO);
+
+  // the pulled cube draws with this VAO left empty
+  gl_state::bindVertexArray(VAO);
+
+  if (!pulled) {
+    gl_state::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, cube_vertices.size(), cube_vertices.data(),
+                 GL_STATIC_DRAW);
+    // recorded in the VAO
+    gl_state::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 cube.indices.size() * sizeof(uint32_t), cube.indices.data(),
+                 GL_STATIC_DRAW);
+
+    pointVertexFormat(cube_format, 0);
+    enableVertexFormat(cube_format);
+  }
 
-  glBindVertexArray(VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  // position attribute
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(0);
-  // texture coord attribute
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-                        (void*)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
+  // Model matrices (CubeInstances when pulling) computed on the CPU are
+  // written straight into a ring of per-frame regions; GPU culling writes
+  // its own into instanceVBO, and GPU animation reads static CubeInstances
+  // from it
+  std::unique_ptr<StreamBuffer> instance_stream;
+  const size_t instance_size =
+      pulled ? sizeof(CubeInstance) : sizeof(glm::mat4);
+  if (OPTIONS.render_mode == INSTANCED ||
+      OPTIONS.render_mode == MULTI_DRAW_INDIRECT || pulled) {
+    // the pacer keeps a region's last reader finished by the time the ring
+    // comes back to it, so the stream itself never waits
+    instance_stream = std::make_unique<StreamBuffer>(
+        n_cubes * instance_size, OPTIONS.frames_in_flight,
+        OPTIONS.persistent);
+  } else if (animated) {
+    std::vector<CubeInstance> cube_instances(n_cubes);
+    for (int i = 0; i < n_cubes; i++) {
+      cube_instances[i] = scene.instance(i);
+    }
+    gl_state::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, n_cubes * sizeof(CubeInstance),
+                 cube_instances.data(), GL_STATIC_DRAW);
+  } else {
+    gl_state::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, n_cubes * sizeof(glm::mat4), NULL,
+                 GL_STREAM_DRAW);
+  }
+  const unsigned int instance_buffer =
+      instance_stream ? instance_stream->buffer() : instanceVBO;
+
+  // per-instance model matrix attribute. A mat4 takes four consecutive
+  // locations (2..5), one vec4 column each, advanced once per instance.
+  VertexFormat instance_format;
+  for (GLuint column = 0; column < 4; column++) {
+    instance_format.attributes.push_back({2 + column, 4, ATTRIBUTE_FLOAT});
+  }
+  instance_format.divisor = 1;
+  // Instance 0 reads the matrix at byte |offset| in the buffer
+  auto pointInstanceAttributes = [&](size_t offset) {
+    gl_state::bindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    pointVertexFormat(instance_format, offset);
+  };
+  if (animated) {
+    // CubeInstance at locations 6 and 7
+    VertexFormat animated_format;
+    animated_format.attributes = {{6, 4, ATTRIBUTE_FLOAT},
+                                  {7, 4, ATTRIBUTE_FLOAT}};
+    animated_format.divisor = 1;
+    gl_state::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    pointVertexFormat(animated_format, 0);
+    enableVertexFormat(animated_format);
+  } else if (!pulled) {
+    pointInstanceAttributes(0);
+    enableVertexFormat(instance_format);
+  }
+  // the pulled cubes read the stream through texture unit 1 instead
+  unsigned int instanceTexture = 0;
+  if (pulled) {
+    glGenTextures(1, &instanceTexture);
+    gl_state::bindTextureUnit(1, GL_TEXTURE_BUFFER, instanceTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_buffer);
+  }
+  size_t instance_offset = 0;
+
+  // Indirect draws: draw i is one instance of the cube starting at instance
+  // i, so it picks up the i-th matrix in the instance buffer. The commands
+  // never change; a run of draws is a range of them.
+  unsigned int indirectBuffer = 0;
+  if (OPTIONS.render_mode == MULTI_DRAW_INDIRECT) {
+    std::vector<gl_ext::DrawElementsIndirectCommand> commands(n_cubes);
+    for (int i = 0; i < n_cubes; i++) {
+      commands[i] = {(GLuint)cube_indices, 1, 0, 0, (GLuint)i};
+    }
+    glGenBuffers(1, &indirectBuffer);
+    gl_state::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 n_cubes * sizeof(gl_ext::DrawElementsIndirectCommand),
+                 commands.data(), GL_STATIC_DRAW);
+  }
+  // Culls on the GPU straight into the instance buffer; the CPU culling,
+  // sorting and matrix passes below then see no visible cubes
+  std::unique_ptr<GpuCuller> gpu_culler;
+  if (OPTIONS.render_mode == GPU_CULL) {
+    gpu_culler = std::make_unique<GpuCuller>(scene, cube_indices, instanceVBO);
+  }
 
   // load and create a texture
   // -------------------------
@@ -170,7 +419,7 @@ void renderTexture() {
   // texture 1
   // ---------
   glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  gl_state::bindTextureUnit(0, GL_TEXTURE_2D, texture);
   // set the texture wrapping parameters
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -192,75 +441,481 @@ void renderTexture() {
   }
   stbi_image_free(data);
 
-  texture_shader.use();
-  texture_shader.set_int("texture", 0);
+  // Tables the state slots of render queue keys index. The queue only ever
+  // holds the active program: the fallback until the textured one is ready.
+  Shader* programs[] = {&fallback_shader, NULL};
+  const unsigned int textures[] = {texture};
+  const unsigned int vaos[] = {VAO};
+  RenderQueue render_queue;
+  render_queue.reserve(n_cubes);
+
+  // Makes |shader| the program cubes are drawn with, sets its constant
+  // uniforms and resolves the ones set inside the render loop
+  Shader* active_shader = NULL;
+  uint32_t active_program = 0;
+  Shader::Uniform model_uniform, instance_base_uniform;
+  auto activateShader = [&](Shader* shader) {
+    active_shader = shader;
+    active_program = shader == &fallback_shader ? 0 : 1;
+    programs[active_program] = shader;
+    shader->use();
+    shader->set_int("texture", 0);
+    shader->set_bool("instanced", instance_matrices);
+    shader->set_bool("animated", animated);
+    shader->set_int("instances", 1);
+    model_uniform = shader->uniform("model");
+    instance_base_uniform = shader->uniform("instance_base");
+  };
+  activateShader(texture_program.ready() && !texture_program.failed()
+                     ? texture_program.shader()
+                     : &fallback_shader);
+
+  // Camera matrices, viewport and time, shared by every program. Only what
+  // changed since the last frame is uploaded, so the projection is sent
+  // once and then again only when it changes (zooming).
+  FrameUniformBuffer frame_uniforms;
+  std::vector<glm::mat4> instance_models(instance_stream ? 0 : n_cubes);
+  // Reported once: instance stream allocations came back NULL
+  bool stream_map_failed = false;
+  // indices of the cubes that survived frustum culling this frame
+  std::vector<int> visible_cubes;
+  visible_cubes.reserve(n_cubes);
+
+  // The cubes only spin in place, so their bounding spheres never move and
+  // the hierarchy is built once
+  Bvh bvh;
+  if (OPTIONS.cull == CULL_BVH) {
+    PROFILE_ZONE("bvh build");
+    std::vector<Aabb> cube_bounds;
+    sphereBounds(scene.x.data(), scene.y.data(), scene.z.data(), CUBE_RADIUS,
+                 n_cubes, cube_bounds);
+    bvh.build(cube_bounds.data(), n_cubes);
+  }
 
-  // note: currently we set the projection matrix each frame, but since the
-  // projection matrix rarely changes it's often best practice to set it
-  // outside the main loop only once.
-  std::array<std::array<float, 4>, constants::nCubes> cube_axes = {};
-  for (int i = 0; i < constants::nCubes; i++) {
-    cube_axes[i] = {random_real(), random_real(), random_real(),
-                    random_real(360)};
-    // std::cout << cube_axes[i][0] << cube_axes[i][1] << cube_axes[i][2]
-    //           << cube_axes[i][3] << std::endl;
+  // Depth of the nearest cubes, rasterized on the CPU to skip hidden ones
+  std::unique_ptr<OcclusionCuller> occlusion_culler;
+  std::vector<std::pair<float, int>> occluder_depths;
+  std::vector<glm::mat4> occluder_models;
+  if (OPTIONS.occlusion && !gpu_culler && !animated) {
+    occlusion_culler = std::make_unique<OcclusionCuller>();
+  }
+  // Bounding box queries deciding which cubes the GPU draws next frame
+  std::unique_ptr<OcclusionQueries> occlusion_queries;
+  if (OPTIONS.render_mode == CONDITIONAL) {
+    // the results are read back only to be reported
+    occlusion_queries = std::make_unique<OcclusionQueries>(
+        n_cubes, OPTIONS.benchmark || OPTIONS.trace);
+  }
+
+  // Per-pass GPU timings, read back a few frames late
+  GpuProfiler gpu_profiler;
+  FramePacer frame_pacer(OPTIONS.frames_in_flight);
+  // Threads the per-cube updates are spread over, this one included
+  JobSystem jobs(OPTIONS.threads);
+
+  // Benchmarks measure the real program only and fly a scripted path
+  std::unique_ptr<FrameBenchmark> benchmark;
+  if (OPTIONS.benchmark) {
+    shader_compiler.finish();
+    activateShader(texture_program.failed() ? &fallback_shader
+                                            : texture_program.shader());
+    benchmark = std::make_unique<FrameBenchmark>(OPTIONS.warmup_frames,
+                                                 OPTIONS.frames);
   }
 
   // Main rendering loop
-  while (!glfwWindowShouldClose(WINDOW)) {
+  while (!shouldClose(benchmark.get())) {
+    PROFILE_ZONE("frame");
+    if (benchmark) {
+      benchmark->beginFrame();
+    }
+    frame_pacer.beginFrame();
+    gpu_profiler.beginFrame(FRAME);
+    gl_state::resetCounters();
+
     // User input listener
-    float current_time = glfwGetTime();
+    float current_time = benchmark ? FRAME * BENCHMARK_TIMESTEP : currentTime();
     delta_time = current_time - last_time;
     last_time = current_time;
-    processInput(delta_time);
+    if (benchmark) {
+      scriptedCameraPose(current_time, scene.center(),
+                         0.75f * scene.field + 3.0f, camera);
+    } else {
+      processInput(delta_time);
+    }
 
     // Clear background and buffer bit
+    gpu_profiler.beginPass("clear");
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Bind texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    // Activate shader
-    texture_shader.use();
+    gpu_profiler.endPass();
+
+    gpu_profiler.beginPass("cubes");
+    // Swap in the textured program as soon as it finished compiling
+    shader_compiler.poll();
+    if (active_shader == &fallback_shader && texture_program.ready() &&
+        !texture_program.failed()) {
+      activateShader(texture_program.shader());
+    }
 
     // Perspective projection. 3D -> 2D
-    glm::mat4 projection = glm::perspective(glm::radians(camera.get_zoom()),
-                                            constants::ASPECT_RATIO,
-                                            constants::NEAR, constants::FAR);
-    texture_shader.set_mat4("projection", projection);
-
+    glm::mat4 projection = camera.GetProjectionMatrix(constants::ASPECT_RATIO);
     glm::mat4 view = camera.GetViewMatrix();
-    texture_shader.set_mat4("view", view);
+    frame_uniforms.setProjection(projection);
+    frame_uniforms.setView(view);
+    frame_uniforms.setViewport(0, 0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
+    frame_uniforms.setTime(current_time);
+    size_t uniform_bytes = frame_uniforms.upload();
+
+    // skip the cubes the camera cannot see
+    CullStats cull_stats;
+    visible_cubes.clear();
+    {
+      PROFILE_ZONE("frustum culling");
+      if (gpu_culler || animated) {
+        // the GPU sees every cube; the culled count is never read back
+      } else if (OPTIONS.cull == CULL_FRUSTUM) {
+        cull_stats = cullSpheres(jobs,
+                                 camera.GetFrustum(constants::ASPECT_RATIO),
+                                 scene.x.data(), scene.y.data(),
+                                 scene.z.data(), CUBE_RADIUS, n_cubes,
+                                 visible_cubes);
+      } else if (OPTIONS.cull == CULL_BVH) {
+        cull_stats =
+            bvh.cull(camera.GetFrustum(constants::ASPECT_RATIO), visible_cubes);
+      } else {
+        for (int i = 0; i < n_cubes; i++) {
+          visible_cubes.push_back(i);
+        }
+        cull_stats.visible = n_cubes;
+      }
+    }
+    int occluded = 0;
+    if (occlusion_culler) {
+      // the nearest survivors occlude the rest
+      occluder_depths.clear();
+      for (int i : visible_cubes) {
+        occluder_depths.push_back(
+            {-(view * glm::vec4(scene.position(i), 1.0f)).z, i});
+      }
+      size_t n_occluders = std::min(occluder_depths.size(),
+                                    (size_t)OcclusionCuller::MAX_OCCLUDERS);
+      std::nth_element(occluder_depths.begin(),
+                       occluder_depths.begin() + n_occluders,
+                       occluder_depths.end());
+      occluder_models.clear();
+      for (size_t i = 0; i < n_occluders; i++) {
+        occluder_models.push_back(
+            scene.model(occluder_depths[i].second, current_time));
+      }
+      occlusion_culler->renderOccluders(projection * view,
+                                        occluder_models.data(),
+                                        (int)occluder_models.size());
+      occluded = occlusion_culler->cullSpheres(
+          scene.x.data(), scene.y.data(), scene.z.data(), CUBE_RADIUS,
+          visible_cubes);
+    }
+    int n_visible = (int)visible_cubes.size();
+
+    // order the draws by state, then front to back
+    {
+      PROFILE_ZONE("render queue sort");
+      render_queue.clear();
+      for (int cube : visible_cubes) {
+        float distance = -(view * glm::vec4(scene.position(cube), 1.0f)).z;
+        render_queue.push(
+            RenderQueue::makeKey(active_program, 0, 0,
+                                 (distance - constants::NEAR) /
+                                     (constants::FAR - constants::NEAR)),
+            cube);
+      }
+      render_queue.sort(jobs);
+      for (int i = 0; i < n_visible; i++) {
+        visible_cubes[i] = render_queue.commands()[i].draw;
+      }
+    }
 
-    // Retrieve the matrix uniform locations
-    unsigned int modelLoc = glGetUniformLocation(texture_shader.id(), "model");
+    // calculate the model matrix for each visible object, streamed straight
+    // into the instance buffer when the draws read them from there. Pulled
+    // cubes are animated by the shader and only need their CubeInstance.
+    // Every job writes its own slice of the mapped buffer.
+    glm::mat4* models = instance_models.data();
+    size_t instances_offset = 0;
+    {
+      PROFILE_ZONE("model matrices");
+      void* instances = NULL;
+      if (instance_stream) {
+        instance_stream->beginFrame();
+        StreamBuffer::Allocation allocation =
+            instance_stream->allocate(n_visible * instance_size);
+        instances = allocation.data;
+        instances_offset = allocation.offset;
+        if (!instances && n_visible > 0) {
+          // the region could not be mapped: no cube is drawn this frame
+          // rather than its instances written through a NULL pointer
+          if (!stream_map_failed) {
+            std::cout << "Could not map the instance stream; cubes not drawn"
+                      << std::endl;
+            stream_map_failed = true;
+          }
+          n_visible = 0;
+        }
+      }
+      if (pulled) {
+        CubeInstance* cube_instances = (CubeInstance*)instances;
+        jobs.parallelFor(0, n_visible, UPDATE_GRAIN, [&](int begin, int end) {
+          for (int i = begin; i < end; i++) {
+            cube_instances[i] = scene.instance(visible_cubes[i]);
+          }
+        });
+      } else {
+        if (instances) {
+          models = (glm::mat4*)instances;
+        }
+        jobs.parallelFor(0, n_visible, UPDATE_GRAIN, [&](int begin, int end) {
+          composeModelMatrices(scene, visible_cubes.data() + begin,
+                               end - begin, current_time, models + begin);
+        });
+      }
+    }
 
     // render box(es)
-    glBindVertexArray(VAO);
-    for (unsigned int i = 0; i < constants::nCubes; i++) {
-      // calculate the model matrix for each object and pass it to shader before
-      // drawing
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, cubePositions[i]);
-      model = glm::rotate(
-          model, (float)glfwGetTime() * glm::radians(cube_axes[i][3]),
-          glm::vec3(cube_axes[i][0], cube_axes[i][1], cube_axes[i][2]));
-      glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-      texture_shader.set_mat4("model", model);
-
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+    int state_changes = 0;
+    {
+      PROFILE_ZONE("draw submission");
+      if (gpu_culler) {
+        gpu_culler->cull(camera.GetFrustum(constants::ASPECT_RATIO),
+                         current_time);
+        programs[active_program]->use();
+        gl_state::bindTextureUnit(0, GL_TEXTURE_2D, texture);
+        gl_state::bindVertexArray(VAO);
+        gpu_culler->draw();
+      } else if (animated) {
+        // the frame's only per-cube input is the time in FrameUniforms
+        programs[active_program]->use();
+        gl_state::bindTextureUnit(0, GL_TEXTURE_2D, texture);
+        gl_state::bindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, cube_indices, GL_UNSIGNED_INT,
+                                NULL, n_cubes);
+      } else if (instance_stream) {
+        instance_stream->flush();
+      }
+      if (occlusion_queries) {
+        occlusion_queries->beginFrame(FRAME);
+      }
+
+      // Walk the sorted queue, changing only the state whose slot differs
+      // from the previous draw's. Each run of draws sharing all state is
+      // one instanced draw or a loop of single draws.
+      const std::vector<RenderCommand>& commands = render_queue.commands();
+      uint32_t program = ~0u, texture_slot = ~0u, vao = ~0u;
+      int run_begin = 0;
+      while (run_begin < n_visible) {
+        uint64_t key = commands[run_begin].key;
+        if (RenderQueue::programOf(key) != program) {
+          program = RenderQueue::programOf(key);
+          programs[program]->use();
+          state_changes++;
+        }
+        if (RenderQueue::textureOf(key) != texture_slot) {
+          texture_slot = RenderQueue::textureOf(key);
+          gl_state::bindTextureUnit(0, GL_TEXTURE_2D, textures[texture_slot]);
+          state_changes++;
+        }
+        if (RenderQueue::vaoOf(key) != vao) {
+          vao = RenderQueue::vaoOf(key);
+          gl_state::bindVertexArray(vaos[vao]);
+          state_changes++;
+        }
+        int run_end = run_begin + 1;
+        while (run_end < n_visible &&
+               commands[run_end].key >> RenderQueue::DEPTH_BITS ==
+                   key >> RenderQueue::DEPTH_BITS) {
+          run_end++;
+        }
+
+        if (OPTIONS.render_mode == INSTANCED) {
+          size_t offset = instances_offset + run_begin * sizeof(glm::mat4);
+          if (instance_offset != offset) {
+            instance_offset = offset;
+            pointInstanceAttributes(instance_offset);
+          }
+          glDrawElementsInstanced(GL_TRIANGLES, cube_indices, GL_UNSIGNED_INT,
+                                  NULL, run_end - run_begin);
+        } else if (pulled) {
+          // two texels per instance
+          programs[program]->set_int(
+              instance_base_uniform,
+              (int)(instances_offset / sizeof(glm::vec4)) + 2 * run_begin);
+          glDrawArraysInstanced(GL_TRIANGLES, 0, 36, run_end - run_begin);
+        } else if (OPTIONS.render_mode == MULTI_DRAW_INDIRECT) {
+          // base instances count from this frame's first matrix
+          if (instance_offset != instances_offset) {
+            instance_offset = instances_offset;
+            pointInstanceAttributes(instance_offset);
+          }
+          gl_state::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+          gl_ext::MultiDrawElementsIndirect(
+              GL_TRIANGLES, GL_UNSIGNED_INT,
+              (void*)(run_begin * sizeof(gl_ext::DrawElementsIndirectCommand)),
+              run_end - run_begin, 0);
+        } else {
+          for (int i = run_begin; i < run_end; i++) {
+            // pass each model matrix to the shader before drawing
+            active_shader->set_mat4(model_uniform, models[i]);
+            if (occlusion_queries) {
+              occlusion_queries->beginConditional(visible_cubes[i]);
+              glDrawElements(GL_TRIANGLES, cube_indices, GL_UNSIGNED_INT,
+                             NULL);
+              occlusion_queries->endConditional();
+            } else {
+              glDrawElements(GL_TRIANGLES, cube_indices, GL_UNSIGNED_INT,
+                             NULL);
+            }
+          }
+        }
+        run_begin = run_end;
+      }
+    }
+    if (occlusion_queries) {
+      // test each cube's bounding box against the finished depth buffer
+      PROFILE_ZONE("occlusion queries");
+      gpu_profiler.beginPass("occlusion queries");
+      gl_state::colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      gl_state::depthMask(GL_FALSE);
+      for (int i = 0; i < n_visible; i++) {
+        glm::vec3 position = scene.position(visible_cubes[i]);
+        // a box around the eye loses its near faces to clipping and would
+        // hide the cube, so cubes that close are always drawn
+        glm::vec4 eye_position = view * glm::vec4(position, 1.0f);
+        if (glm::length(glm::vec3(eye_position.x, eye_position.y,
+                                  eye_position.z)) <
+            2.0f * CUBE_RADIUS + constants::NEAR) {
+          continue;
+        }
+        glm::mat4 box = glm::scale(glm::translate(glm::mat4(1.0f), position),
+                                   glm::vec3(2.0f * CUBE_RADIUS));
+        active_shader->set_mat4(model_uniform, box);
+        occlusion_queries->beginQuery(visible_cubes[i]);
+        glDrawElements(GL_TRIANGLES, cube_indices, GL_UNSIGNED_INT, NULL);
+        occlusion_queries->endQuery();
+      }
+      gl_state::colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      gl_state::depthMask(GL_TRUE);
+      gpu_profiler.endPass();
+
+      const OcclusionQueries::Stats& stats = occlusion_queries->stats();
+      profiler::counter("conditional draws", stats.conditional_draws);
+      profiler::counter("gpu occluded cubes", stats.occluded);
     }
+    gpu_profiler.endPass();
+    if (instance_stream) {
+      instance_stream->endFrame();
+      profiler::counter("stream wait ms", instance_stream->lastWaitMs());
+    }
+
+    profiler::counter("gl calls issued", gl_state::counters().issued);
+    profiler::counter("gl calls elided", gl_state::counters().elided);
 
     // Buffer swap
-    glfwPollEvents();
-    glfwSwapBuffers(WINDOW);
+    gpu_profiler.beginPass("swap");
+    presentFrame();
+    gpu_profiler.endPass();
+    gpu_profiler.endFrame();
+    frame_pacer.endFrame();
+    profiler::counter("pacing wait ms", frame_pacer.lastWaitMs());
+    if (benchmark) {
+      benchmark->recordCounter("visible_cubes", cull_stats.visible);
+      benchmark->recordCounter("culled_cubes", cull_stats.culled);
+      benchmark->recordCounter("state_changes", state_changes);
+      benchmark->recordCounter("uniform_bytes", uniform_bytes);
+      benchmark->recordCounter("vertex_fetch_bytes",
+                               n_visible * cube_fetch_bytes);
+      benchmark->recordCounter("pacing_wait_ms", frame_pacer.lastWaitMs());
+      benchmark->recordCounter("gl_calls_issued",
+                               gl_state::counters().issued);
+      benchmark->recordCounter("gl_calls_elided",
+                               gl_state::counters().elided);
+      if (instance_stream) {
+        benchmark->recordCounter("stream_wait_ms",
+                                 instance_stream->lastWaitMs());
+      }
+      if (occlusion_culler) {
+        const OcclusionStats& stats = occlusion_culler->stats();
+        benchmark->recordCounter("occluded_cubes", occluded);
+        benchmark->recordCounter("occlusion_raster_ms", stats.raster_ms);
+        benchmark->recordCounter("occlusion_test_ms", stats.test_ms);
+      }
+      if (occlusion_queries) {
+        const OcclusionQueries::Stats& stats = occlusion_queries->stats();
+        benchmark->recordCounter("conditional_draws", stats.conditional_draws);
+        benchmark->recordCounter("unconditional_draws",
+                                 stats.unconditional_draws);
+        benchmark->recordCounter("occlusion_queries", stats.queries_issued);
+        benchmark->recordCounter("gpu_occluded_cubes", stats.occluded);
+      }
+      benchmark->endFrame(gpu_profiler);
+    }
+  }
+
+  if (benchmark) {
+    std::ostringstream config;
+    config << "{\"mode\": \""
+           << renderModeName(OPTIONS.render_mode)
+           << "\", \"cubes\": " << n_cubes << ", \"seed\": " << OPTIONS.seed
+           << ", \"warmup_frames\": " << OPTIONS.warmup_frames
+           << ", \"frames\": " << OPTIONS.frames
+           << ", \"cull\": \""
+           << (OPTIONS.cull == CULL_BVH       ? "bvh"
+               : OPTIONS.cull == CULL_FRUSTUM ? "frustum"
+                                              : "off")
+           << "\", \"occlusion\": " << (OPTIONS.occlusion ? "true" : "false")
+           << ", \"threads\": " << jobs.threads()
+           << ", \"frames_in_flight\": " << OPTIONS.frames_in_flight
+           << ", \"vertex_format\": \""
+           << vertexPackingName(OPTIONS.vertex_format) << "\""
+           << ", \"persistent\": "
+           << (instance_stream && instance_stream->persistent() ? "true"
+                                                                : "false")
+           << ", \"transform_isa\": \"" << transformKernelIsa() << "\""
+           << ", \"headless\": " << (OPTIONS.headless ? "true" : "false")
+           << ", \"renderer\": \"" << glGetString(GL_RENDERER) << "\"}";
+    if (OPTIONS.benchmark_output) {
+      std::ofstream out(OPTIONS.benchmark_output);
+      benchmark->writeReport(out, config.str().c_str(), gpu_profiler);
+      std::cout << "Wrote " << OPTIONS.benchmark_output << std::endl;
+    } else {
+      benchmark->writeReport(std::cout, config.str().c_str(),
+                             gpu_profiler);
+    }
+  }
+
+  if (OPTIONS.trace) {
+    if (profiler::writeChromeTrace(OPTIONS.trace)) {
+      std::cout << "Wrote " << OPTIONS.trace << std::endl;
+    } else {
+      std::cout << "No trace written; build with LEARNOPENGL_PROFILE"
+                << std::endl;
+    }
+  }
+
+  if (OPTIONS.headless && OPTIONS.screenshot) {
+    if (headless::saveScreenshot(OPTIONS.screenshot)) {
+      std::cout << "Saved " << OPTIONS.screenshot << std::endl;
+    }
   }
 }
 
-int main(void) {
-  windowSetup();
-  glEnable(GL_DEPTH_TEST);
+int main(int argc, char** argv) {
+  OPTIONS = parseOptions(argc, argv);
+  profiler::setThreadName("render");
+  if (OPTIONS.headless) {
+    if (!headless::setup(constants::WIDTH, constants::HEIGHT)) {
+      return -1;
+    }
+  } else {
+    windowSetup();
+  }
+  gl_state::enable(GL_DEPTH_TEST);
 
   int i = 1;
   switch (i) {
@@ -271,6 +926,12 @@ int main(void) {
       break;
   }
 
-  glfwTerminate();
+  if (OPTIONS.headless) {
+    std::cout << "Rendered " << FRAME << " frames in " << currentTime()
+              << " s" << std::endl;
+    headless::teardown();
+  } else {
+    glfwTerminate();
+  }
   return 0;
 }
@@ -0,0 +1,243 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Forsyth's scoring: recently used vertices score high, as do vertices with
+// few triangles left, so lone triangles do not get stranded
+const int SCORE_CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+const int VALENCE_TABLE_SIZE = 32;
+
+// Score terms tabulated once; pow() per update would dominate the run time
+struct ScoreTables {
+  float cache[SCORE_CACHE_SIZE];
+  float valence[VALENCE_TABLE_SIZE];
+
+  ScoreTables() {
+    for (int i = 0; i < SCORE_CACHE_SIZE; i++) {
+      // the triangle just emitted; using it again right away is no gain
+      cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                       : std::pow(1.0f - (i - 3) / (SCORE_CACHE_SIZE - 3.0f),
+                                  CACHE_DECAY_POWER);
+    }
+    valence[0] = 0.0f;
+    for (int i = 1; i < VALENCE_TABLE_SIZE; i++) {
+      valence[i] =
+          VALENCE_BOOST_SCALE * std::pow((float)i, -VALENCE_BOOST_POWER);
+    }
+  }
+};
+
+float vertexScore(int cache_position, int remaining_triangles) {
+  static const ScoreTables tables;
+  if (remaining_triangles == 0) {
+    return -1.0f;
+  }
+  float score = cache_position >= 0 ? tables.cache[cache_position] : 0.0f;
+  return score + (remaining_triangles < VALENCE_TABLE_SIZE
+                      ? tables.valence[remaining_triangles]
+                      : VALENCE_BOOST_SCALE *
+                            std::pow((float)remaining_triangles,
+                                     -VALENCE_BOOST_POWER));
+}
+
+// Hashes and compares vertices by index into the source array
+struct VertexHash {
+  const float* vertices;
+  int stride;
+  size_t operator()(uint32_t vertex) const {
+    const unsigned char* bytes =
+        (const unsigned char*)(vertices + (size_t)vertex * stride);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < stride * sizeof(float); i++) {
+      hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+  }
+};
+struct VertexEqual {
+  const float* vertices;
+  int stride;
+  bool operator()(uint32_t a, uint32_t b) const {
+    return std::memcmp(vertices + (size_t)a * stride,
+                       vertices + (size_t)b * stride,
+                       stride * sizeof(float)) == 0;
+  }
+};
+
+}  // namespace
+
+float acmr(const uint32_t* indices, size_t n_indices, int cache_size) {
+  if (n_indices < 3) {
+    return 0.0f;
+  }
+  // FIFO: a hit does not move the vertex
+  std::vector<uint32_t> cache(cache_size, UINT32_MAX);
+  size_t next = 0;
+  size_t misses = 0;
+  for (size_t i = 0; i < n_indices; i++) {
+    if (std::find(cache.begin(), cache.end(), indices[i]) == cache.end()) {
+      cache[next] = indices[i];
+      next = (next + 1) % cache_size;
+      misses++;
+    }
+  }
+  return (float)misses / (n_indices / 3);
+}
+
+IndexedMesh indexVertices(const float* vertices, int n_vertices, int stride) {
+  IndexedMesh mesh;
+  mesh.stride = stride;
+  mesh.indices.resize(n_vertices);
+  std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique(
+      n_vertices, VertexHash{vertices, stride}, VertexEqual{vertices, stride});
+  for (int i = 0; i < n_vertices; i++) {
+    auto inserted = unique.emplace(i, (uint32_t)mesh.vertexCount());
+    if (inserted.second) {
+      mesh.vertices.insert(mesh.vertices.end(), vertices + (size_t)i * stride,
+                           vertices + (size_t)(i + 1) * stride);
+    }
+    mesh.indices[i] = inserted.first->second;
+  }
+  return mesh;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, int n_vertices) {
+  const int n_triangles = (int)indices.size() / 3;
+  if (n_triangles == 0) {
+    return;
+  }
+
+  // triangles of each vertex, packed; the first remaining[v] of a vertex's
+  // span are the ones not yet emitted
+  std::vector<int> remaining(n_vertices, 0);
+  for (uint32_t index : indices) {
+    remaining[index]++;
+  }
+  std::vector<int> adjacency_begin(n_vertices + 1, 0);
+  for (int v = 0; v < n_vertices; v++) {
+    adjacency_begin[v + 1] = adjacency_begin[v] + remaining[v];
+  }
+  std::vector<int> adjacency(indices.size());
+  std::vector<int> filled(n_vertices, 0);
+  for (int t = 0; t < n_triangles; t++) {
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = indices[3 * t + k];
+      adjacency[adjacency_begin[v] + filled[v]++] = t;
+    }
+  }
+
+  std::vector<int> cache_position(n_vertices, -1);
+  std::vector<float> vertex_score(n_vertices);
+  for (int v = 0; v < n_vertices; v++) {
+    vertex_score[v] = vertexScore(-1, remaining[v]);
+  }
+  std::vector<char> emitted(n_triangles, 0);
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  // LRU order, most recent first; three more than scored while updating
+  std::vector<uint32_t> cache, next_cache;
+  cache.reserve(SCORE_CACHE_SIZE + 3);
+  next_cache.reserve(SCORE_CACHE_SIZE + 3);
+  int best = 0;
+  int scan = 0;
+  for (int emitted_count = 0; emitted_count < n_triangles; emitted_count++) {
+    if (best < 0) {
+      // nothing in the cache touches a remaining triangle: take the next
+      // one in input order, which keeps the search linear overall
+      while (emitted[scan]) {
+        scan++;
+      }
+      best = scan;
+    }
+    emitted[best] = 1;
+    const uint32_t* triangle = &indices[3 * best];
+    output.insert(output.end(), triangle, triangle + 3);
+
+    next_cache.assign(triangle, triangle + 3);
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = triangle[k];
+      int* span = &adjacency[adjacency_begin[v]];
+      int* last = span + --remaining[v];
+      std::swap(*std::find(span, last + 1, best), *last);
+    }
+    for (uint32_t v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        next_cache.push_back(v);
+      }
+    }
+    cache.swap(next_cache);
+
+    for (int i = 0; i < (int)cache.size(); i++) {
+      uint32_t v = cache[i];
+      cache_position[v] = i < SCORE_CACHE_SIZE ? i : -1;
+      vertex_score[v] = vertexScore(cache_position[v], remaining[v]);
+    }
+    best = -1;
+    float best_score = -1.0f;
+    for (uint32_t v : cache) {
+      for (int a = 0; a < remaining[v]; a++) {
+        int t = adjacency[adjacency_begin[v] + a];
+        float score = vertex_score[indices[3 * t]] +
+                      vertex_score[indices[3 * t + 1]] +
+                      vertex_score[indices[3 * t + 2]];
+        if (score > best_score) {
+          best_score = score;
+          best = t;
+        }
+      }
+    }
+    if (cache.size() > (size_t)SCORE_CACHE_SIZE) {
+      cache.resize(SCORE_CACHE_SIZE);
+    }
+  }
+  indices.swap(output);
+}
+
+void optimizeVertexFetch(IndexedMesh& mesh) {
+  const int n_vertices = mesh.vertexCount();
+  std::vector<uint32_t> remap(n_vertices, UINT32_MAX);
+  std::vector<float> vertices(mesh.vertices.size());
+  uint32_t next = 0;
+  for (uint32_t& index : mesh.indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = next;
+      std::copy(mesh.vertices.begin() + (size_t)index * mesh.stride,
+                mesh.vertices.begin() + (size_t)(index + 1) * mesh.stride,
+                vertices.begin() + (size_t)next * mesh.stride);
+      next++;
+    }
+    index = remap[index];
+  }
+  // unreferenced vertices are dropped
+  vertices.resize((size_t)next * mesh.stride);
+  mesh.vertices.swap(vertices);
+}
+
+IndexedMesh buildIndexedMesh(const float* vertices,
+                             int n_vertices,
+                             int stride,
+                             MeshStats* stats) {
+  IndexedMesh mesh = indexVertices(vertices, n_vertices, stride);
+  optimizeVertexCache(mesh.indices, mesh.vertexCount());
+  optimizeVertexFetch(mesh);
+  if (stats) {
+    stats->input_vertices = n_vertices;
+    stats->unique_vertices = mesh.vertexCount();
+    stats->triangles = n_vertices / 3;
+    // drawn as given every vertex is transformed
+    stats->acmr_before = n_vertices ? 3.0f : 0.0f;
+    stats->acmr_after =
+        acmr(mesh.indices.data(), mesh.indices.size(), VERTEX_CACHE_SIZE);
+  }
+  return mesh;
+}
@@ -0,0 +1,54 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Interleaved float vertices and triangle-list indices into them
+struct IndexedMesh {
+  std::vector<float> vertices;
+  // Floats per vertex
+  int stride = 0;
+  std::vector<uint32_t> indices;
+
+  int vertexCount() const { return stride ? (int)vertices.size() / stride : 0; }
+};
+
+// What buildIndexedMesh() did
+struct MeshStats {
+  int input_vertices = 0;
+  int unique_vertices = 0;
+  int triangles = 0;
+  // Average cache miss ratio, transformed vertices per triangle, of the
+  // input drawn as given and of the result
+  float acmr_before = 0.0f;
+  float acmr_after = 0.0f;
+};
+
+// Post-transform cache size acmr() simulates, about what GPUs have had
+const int VERTEX_CACHE_SIZE = 16;
+
+// Average cache miss ratio of |indices| through a FIFO vertex cache of
+// |cache_size| entries. 3 is the worst, 0.5 the best for large regular
+// meshes.
+float acmr(const uint32_t* indices, size_t n_indices, int cache_size);
+
+// Merges bit-identical vertices of a non-indexed triangle list
+IndexedMesh indexVertices(const float* vertices, int n_vertices, int stride);
+
+// Reorders triangles so consecutive ones share vertices still in the
+// post-transform cache (Forsyth, "Linear-speed vertex cache optimisation")
+void optimizeVertexCache(std::vector<uint32_t>& indices, int n_vertices);
+
+// Reorders vertices by first use in |mesh|.indices so vertex fetch streams
+// through memory, and renumbers the indices to match
+void optimizeVertexFetch(IndexedMesh& mesh);
+
+// The three above in order, for a non-indexed triangle list
+IndexedMesh buildIndexedMesh(const float* vertices,
+                             int n_vertices,
+                             int stride,
+                             MeshStats* stats = NULL);
+
+#endif
@@ -0,0 +1,344 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Depth buffer rows per rasterizer job
+const int BAND_ROWS = 16;
+const int BANDS = (OcclusionCuller::HEIGHT + BAND_ROWS - 1) / BAND_ROWS;
+
+// Clip-space w below which a vertex counts as behind the eye
+const float MIN_W = 1e-3f;
+
+// Unit cube corners and its 12 triangles
+const float CUBE_CORNERS[8][3] = {
+    {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f},
+    {-0.5f, 0.5f, -0.5f},  {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f},
+    {0.5f, 0.5f, 0.5f},    {-0.5f, 0.5f, 0.5f}};
+const int CUBE_TRIANGLES[12][3] = {{0, 1, 2}, {0, 2, 3}, {4, 6, 5}, {4, 7, 6},
+                                   {0, 4, 5}, {0, 5, 1}, {3, 2, 6}, {3, 6, 7},
+                                   {0, 3, 7}, {0, 7, 4}, {1, 5, 6}, {1, 6, 2}};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Edge function A * x + B * y + C, positive left of a->b
+struct Edge {
+  float a, b, c;
+
+  Edge(const glm::vec3& from, const glm::vec3& to)
+      : a(from.y - to.y),
+        b(to.x - from.x),
+        c(-(a * from.x + b * from.y)) {}
+};
+
+}  // namespace
+
+OcclusionCuller::OcclusionCuller(int threads) {
+  Level level = {WIDTH, HEIGHT, std::vector<float>()};
+  for (;;) {
+    level.depth.assign((size_t)level.width * level.height, 1.0f);
+    levels_.push_back(level);
+    if (level.width == 1 && level.height == 1) {
+      break;
+    }
+    level.width = (level.width + 1) / 2;
+    level.height = (level.height + 1) / 2;
+  }
+
+  if (threads <= 0) {
+    threads = (int)std::max(1u, std::thread::hardware_concurrency());
+  }
+  int n_workers = std::min(threads, BANDS) - 1;
+  for (int i = 0; i < n_workers; i++) {
+    workers_.emplace_back(&OcclusionCuller::workerLoop, this);
+  }
+}
+
+OcclusionCuller::~OcclusionCuller() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void OcclusionCuller::workerLoop() {
+  profiler::setThreadName("occlusion raster");
+  unsigned int seen = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+    if (quit_) {
+      return;
+    }
+    seen = generation_;
+    while (next_band_ < bands_) {
+      int band = next_band_++;
+      lock.unlock();
+      (*job_)(band);
+      lock.lock();
+      if (++finished_ == bands_) {
+        done_.notify_one();
+      }
+    }
+  }
+}
+
+void OcclusionCuller::runBands(const std::function<void(int)>& job,
+                               int bands) {
+  if (workers_.empty()) {
+    for (int band = 0; band < bands; band++) {
+      job(band);
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = &job;
+  bands_ = bands;
+  next_band_ = 0;
+  finished_ = 0;
+  generation_++;
+  wake_.notify_all();
+  // take bands ourselves rather than sleep
+  while (next_band_ < bands_) {
+    int band = next_band_++;
+    lock.unlock();
+    job(band);
+    lock.lock();
+    finished_++;
+  }
+  done_.wait(lock, [&] { return finished_ == bands_; });
+  job_ = NULL;
+}
+
+void OcclusionCuller::renderOccluders(const glm::mat4& clip_from_world,
+                                      const glm::mat4* models,
+                                      int count) {
+  PROFILE_ZONE("occlusion raster");
+  auto start = std::chrono::steady_clock::now();
+  stats_ = OcclusionStats();
+  clip_from_world_ = clip_from_world;
+
+  triangles_.clear();
+  for (int i = 0; i < count; i++) {
+    glm::mat4 clip_from_model = clip_from_world * models[i];
+    glm::vec3 screen[8];
+    bool behind = false;
+    for (int c = 0; c < 8 && !behind; c++) {
+      glm::vec4 clip = clip_from_model * glm::vec4(CUBE_CORNERS[c][0],
+                                                   CUBE_CORNERS[c][1],
+                                                   CUBE_CORNERS[c][2], 1.0f);
+      // in front of the near plane (NDC z < -1) too: such a corner would
+      // rasterize nearer than anything the GPU keeps at its pixels
+      if (clip.w < MIN_W || clip.z < -clip.w) {
+        behind = true;
+        break;
+      }
+      float inv_w = 1.0f / clip.w;
+      screen[c] = glm::vec3((clip.x * inv_w * 0.5f + 0.5f) * WIDTH,
+                            (clip.y * inv_w * 0.5f + 0.5f) * HEIGHT,
+                            clip.z * inv_w);
+    }
+    // clipping occluders is not worth it, dropping them is conservative
+    if (behind) {
+      continue;
+    }
+    for (const int* corners : CUBE_TRIANGLES) {
+      triangles_.push_back(
+          {{screen[corners[0]], screen[corners[1]], screen[corners[2]]}});
+    }
+    stats_.occluders++;
+  }
+
+  std::function<void(int)> job = [this](int band) {
+    rasterizeBand(band * BAND_ROWS, std::min(HEIGHT, (band + 1) * BAND_ROWS));
+  };
+  runBands(job, BANDS);
+  buildPyramid();
+  stats_.raster_ms = millisecondsSince(start);
+}
+
+void OcclusionCuller::rasterizeBand(int row_begin, int row_end) {
+  float* depth = levels_[0].depth.data();
+  std::fill(depth + (size_t)row_begin * WIDTH, depth + (size_t)row_end * WIDTH,
+            1.0f);
+
+  for (const Triangle& triangle : triangles_) {
+    glm::vec3 v0 = triangle.v[0], v1 = triangle.v[1], v2 = triangle.v[2];
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (area == 0.0f) {
+      continue;
+    }
+    // either facing does: the nearer faces win the depth test anyway
+    if (area < 0.0f) {
+      std::swap(v1, v2);
+      area = -area;
+    }
+
+    int x_begin = std::max(
+        0, (int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+    int x_end = std::min(
+        WIDTH, (int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))) + 1);
+    int y_begin = std::max(
+        row_begin, (int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+    int y_end = std::min(
+        row_end, (int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))) + 1);
+    if (x_begin >= x_end || y_begin >= y_end) {
+      continue;
+    }
+    // whole groups of four, WIDTH is a multiple of four
+    x_begin &= ~3;
+
+    // Barycentric weights are the edge functions over the area, and depth is
+    // linear in screen space: z = zx * x + zy * y + zc
+    Edge e0(v1, v2), e1(v2, v0), e2(v0, v1);
+    float inv_area = 1.0f / area;
+    float zx = (e0.a * v0.z + e1.a * v1.z + e2.a * v2.z) * inv_area;
+    float zy = (e0.b * v0.z + e1.b * v1.z + e2.b * v2.z) * inv_area;
+    float zc = (e0.c * v0.z + e1.c * v1.z + e2.c * v2.z) * inv_area;
+
+    for (int y = y_begin; y < y_end; y++) {
+      float* row = depth + (size_t)y * WIDTH;
+      float py = y + 0.5f;
+#ifdef OCCLUSION_SSE
+      const __m128 zero = _mm_setzero_ps();
+      __m128 px = _mm_add_ps(_mm_set1_ps(x_begin + 0.5f),
+                             _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+      const __m128 step = _mm_set1_ps(4.0f);
+      for (int x = x_begin; x < x_end; x += 4) {
+        __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0.a), px),
+                               _mm_set1_ps(e0.b * py + e0.c));
+        __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1.a), px),
+                               _mm_set1_ps(e1.b * py + e1.c));
+        __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2.a), px),
+                               _mm_set1_ps(e2.b * py + e2.c));
+        __m128 inside = _mm_and_ps(
+            _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+            _mm_cmpge_ps(w2, zero));
+        if (_mm_movemask_ps(inside)) {
+          __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px),
+                                _mm_set1_ps(zy * py + zc));
+          __m128 old = _mm_loadu_ps(row + x);
+          __m128 nearer = _mm_min_ps(old, z);
+          _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer),
+                                           _mm_andnot_ps(inside, old)));
+        }
+        px = _mm_add_ps(px, step);
+      }
+#else
+      for (int x = x_begin; x < x_end; x++) {
+        float px = x + 0.5f;
+        if (e0.a * px + e0.b * py + e0.c >= 0.0f &&
+            e1.a * px + e1.b * py + e1.c >= 0.0f &&
+            e2.a * px + e2.b * py + e2.c >= 0.0f) {
+          row[x] = std::min(row[x], zx * px + zy * py + zc);
+        }
+      }
+#endif
+    }
+  }
+}
+
+void OcclusionCuller::buildPyramid() {
+  for (size_t l = 1; l < levels_.size(); l++) {
+    const Level& source = levels_[l - 1];
+    Level& level = levels_[l];
+    for (int y = 0; y < level.height; y++) {
+      const float* row0 = &source.depth[(size_t)(2 * y) * source.width];
+      const float* row1 =
+          &source.depth[(size_t)std::min(2 * y + 1, source.height - 1) *
+                        source.width];
+      for (int x = 0; x < level.width; x++) {
+        int x0 = 2 * x;
+        int x1 = std::min(x0 + 1, source.width - 1);
+        level.depth[(size_t)y * level.width + x] = std::max(
+            std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+      }
+    }
+  }
+}
+
+bool OcclusionCuller::testSphere(const glm::vec3& center, float radius) const {
+  // screen rectangle and nearest depth of the sphere's bounding box
+  float x_min = 1.0f, x_max = -1.0f, y_min = 1.0f, y_max = -1.0f;
+  float z_min = 1.0f;
+  for (int c = 0; c < 8; c++) {
+    glm::vec4 corner(center.x + (c & 1 ? radius : -radius),
+                     center.y + (c & 2 ? radius : -radius),
+                     center.z + (c & 4 ? radius : -radius), 1.0f);
+    glm::vec4 clip = clip_from_world_ * corner;
+    if (clip.w < MIN_W) {
+      return true;
+    }
+    float inv_w = 1.0f / clip.w;
+    x_min = std::min(x_min, clip.x * inv_w);
+    x_max = std::max(x_max, clip.x * inv_w);
+    y_min = std::min(y_min, clip.y * inv_w);
+    y_max = std::max(y_max, clip.y * inv_w);
+    z_min = std::min(z_min, clip.z * inv_w);
+  }
+  if (x_max < -1.0f || x_min > 1.0f || y_max < -1.0f || y_min > 1.0f) {
+    return true;
+  }
+
+  int x0 = std::max(0, (int)((x_min * 0.5f + 0.5f) * WIDTH));
+  int x1 = std::min(WIDTH - 1, (int)((x_max * 0.5f + 0.5f) * WIDTH));
+  int y0 = std::max(0, (int)((y_min * 0.5f + 0.5f) * HEIGHT));
+  int y1 = std::min(HEIGHT - 1, (int)((y_max * 0.5f + 0.5f) * HEIGHT));
+  // coarsen until the rectangle spans at most 2x2 texels
+  size_t l = 0;
+  while (l + 1 < levels_.size() && (x1 - x0 > 1 || y1 - y0 > 1)) {
+    x0 >>= 1;
+    x1 >>= 1;
+    y0 >>= 1;
+    y1 >>= 1;
+    l++;
+  }
+  const Level& level = levels_[l];
+  float farthest = -1.0f;
+  for (int y = y0; y <= y1; y++) {
+    for (int x = x0; x <= x1; x++) {
+      farthest = std::max(farthest, level.depth[(size_t)y * level.width + x]);
+    }
+  }
+  return z_min <= farthest;
+}
+
+int OcclusionCuller::cullSpheres(const float* x,
+                                 const float* y,
+                                 const float* z,
+                                 float radius,
+                                 std::vector<int>& visible) {
+  PROFILE_ZONE("occlusion test");
+  auto start = std::chrono::steady_clock::now();
+  size_t kept = 0;
+  for (int i : visible) {
+    if (testSphere(glm::vec3(x[i], y[i], z[i]), radius)) {
+      visible[kept++] = i;
+    }
+  }
+  int occluded = (int)(visible.size() - kept);
+  stats_.tested += (int)visible.size();
+  stats_.occluded += occluded;
+  visible.resize(kept);
+  stats_.test_ms += millisecondsSince(start);
+  return occluded;
+}
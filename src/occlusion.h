@@ -0,0 +1,107 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <condition_variable>
+#include <functional>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counters and CPU cost of one OcclusionCuller frame
+struct OcclusionStats {
+  int occluders = 0;
+  int tested = 0;
+  int occluded = 0;
+  // Transforming and rasterizing occluders, and building the pyramid
+  double raster_ms = 0.0;
+  // Testing the candidates against the pyramid
+  double test_ms = 0.0;
+};
+
+// Software occlusion culling against a hierarchical-Z pyramid.
+//
+// Each frame the nearest objects are rasterized as box occluders into a
+// small CPU depth buffer, four pixels at a time with SSE where available.
+// The buffer is split into horizontal bands rasterized in parallel on worker
+// threads. A pyramid of farthest depths is then built over it, so a
+// candidate's screen rectangle is tested against a handful of texels from
+// the level where the rectangle spans at most two.
+//
+// Depths are NDC z in [-1, 1]. Coverage is sampled at texel centers.
+class OcclusionCuller {
+ public:
+  // Depth buffer resolution; about the window's aspect ratio
+  static const int WIDTH = 256;
+  static const int HEIGHT = 144;
+  // Occluders worth rasterizing per frame; callers pass the nearest objects
+  static const int MAX_OCCLUDERS = 128;
+
+  // |threads| rasterize, the caller included; 0 means one per hardware
+  // thread
+  explicit OcclusionCuller(int threads = 0);
+  ~OcclusionCuller();
+  OcclusionCuller(const OcclusionCuller&) = delete;
+  OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+  // Clears the depth buffer and rasterizes |count| occluders, each the unit
+  // cube transformed by |models[i]|, seen through |clip_from_world|.
+  // Occluders crossing the near plane are skipped.
+  void renderOccluders(const glm::mat4& clip_from_world,
+                       const glm::mat4* models,
+                       int count);
+
+  // True if the sphere could be visible against the last renderOccluders()
+  bool testSphere(const glm::vec3& center, float radius) const;
+
+  // Removes from |visible| the spheres of common |radius| centered at
+  // (x[i], y[i], z[i]) that are hidden. Returns the number removed.
+  int cullSpheres(const float* x,
+                  const float* y,
+                  const float* z,
+                  float radius,
+                  std::vector<int>& visible);
+
+  // Counters of the current frame, reset by renderOccluders()
+  const OcclusionStats& stats() const { return stats_; }
+
+ private:
+  // Screen-space triangle: x, y in texels, z in NDC
+  struct Triangle {
+    glm::vec3 v[3];
+  };
+  struct Level {
+    int width;
+    int height;
+    std::vector<float> depth;
+  };
+
+  // Rasterizes every triangle into rows [row_begin, row_end)
+  void rasterizeBand(int row_begin, int row_end);
+  void buildPyramid();
+  // Runs |job(band)| for bands 0..|bands| - 1, spread over the workers and
+  // the caller
+  void runBands(const std::function<void(int)>& job, int bands);
+  void workerLoop();
+
+  glm::mat4 clip_from_world_;
+  std::vector<Triangle> triangles_;
+  // levels_[0] is the depth buffer, each next level a 2x2 farthest-depth
+  // reduction of the one before (odd sizes round up)
+  std::vector<Level> levels_;
+  OcclusionStats stats_;
+
+  // Persistent rasterizer threads, woken once per frame
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int)>* job_ = NULL;
+  int next_band_ = 0;
+  int bands_ = 0;
+  int finished_ = 0;
+  unsigned int generation_ = 0;
+  bool quit_ = false;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "occlusion_queries.h"
+
+#include <cstddef>
+#include <glad/glad.h>
+
+OcclusionQueries::OcclusionQueries(int n_objects, bool read_results)
+    : queries_(2 * (size_t)n_objects, 0),
+      query_frames_(n_objects, -1),
+      read_results_(read_results) {}
+
+OcclusionQueries::~OcclusionQueries() {
+  for (unsigned int query : queries_) {
+    if (query) {
+      glDeleteQueries(1, &query);
+    }
+  }
+}
+
+void OcclusionQueries::beginFrame(int frame) {
+  frame_ = frame;
+  stats_ = Stats();
+  queried_previous_.swap(queried_current_);
+  queried_current_.clear();
+  if (!read_results_) {
+    return;
+  }
+
+  // statistics only: rendering never depends on these
+  for (int object : queried_previous_) {
+    unsigned int query = queries_[2 * (size_t)object + ((frame_ - 1) & 1)];
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+      GLuint any_samples = GL_TRUE;
+      glGetQueryObjectuiv(query, GL_QUERY_RESULT, &any_samples);
+      stats_.results_read++;
+      if (!any_samples) {
+        stats_.occluded++;
+      }
+    }
+  }
+}
+
+void OcclusionQueries::beginConditional(int object) {
+  conditional_ = query_frames_[object] == frame_ - 1;
+  if (conditional_) {
+    glBeginConditionalRender(
+        queries_[2 * (size_t)object + ((frame_ - 1) & 1)], GL_QUERY_NO_WAIT);
+    stats_.conditional_draws++;
+  } else {
+    stats_.unconditional_draws++;
+  }
+}
+
+void OcclusionQueries::endConditional() {
+  if (conditional_) {
+    glEndConditionalRender();
+    conditional_ = false;
+  }
+}
+
+void OcclusionQueries::beginQuery(int object) {
+  unsigned int& query = queries_[2 * (size_t)object + (frame_ & 1)];
+  if (!query) {
+    glGenQueries(1, &query);
+  }
+  glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+  query_frames_[object] = frame_;
+  queried_current_.push_back(object);
+  stats_.queries_issued++;
+}
+
+void OcclusionQueries::endQuery() {
+  glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
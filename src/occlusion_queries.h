@@ -0,0 +1,71 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include <vector>
+
+// GPU occlusion culling with GL_ANY_SAMPLES_PASSED queries and conditional
+// rendering. Each frame an object's full draw is made conditional on the
+// query of its bounding box issued the frame before, in GL_QUERY_NO_WAIT
+// mode: if that result has not arrived the object is simply drawn, so the
+// CPU never waits. The boxes are then queried against this frame's depth
+// for use by the next one.
+//
+//   queries.beginFrame(frame);
+//   for each object:  queries.beginConditional(i); draw; endConditional();
+//   (color and depth writes off)
+//   for each object:  queries.beginQuery(i); draw box; queries.endQuery();
+//
+// Two query objects per object alternate between frames, created the first
+// time the object is queried.
+class OcclusionQueries {
+ public:
+  struct Stats {
+    // Draws made conditional on last frame's query
+    int conditional_draws = 0;
+    // Draws without a query from last frame to go on
+    int unconditional_draws = 0;
+    int queries_issued = 0;
+    // Last frame's queries whose result had arrived by beginFrame(), and
+    // how many of those found their box hidden; only with |read_results|
+    int results_read = 0;
+    int occluded = 0;
+  };
+
+  // |read_results| fills the results_read and occluded counters, at the
+  // cost of two glGetQueryObjectuiv calls per queried object and frame;
+  // leave it off unless the counters are reported
+  OcclusionQueries(int n_objects, bool read_results);
+  ~OcclusionQueries();
+  OcclusionQueries(const OcclusionQueries&) = delete;
+  OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+  // Resets the counters and, with |read_results|, reads back whichever of
+  // last frame's results are already available, without waiting
+  void beginFrame(int frame);
+
+  // Brackets the full draw of |object|
+  void beginConditional(int object);
+  void endConditional();
+
+  // Brackets the bounding box draw of |object|
+  void beginQuery(int object);
+  void endQuery();
+
+  // Counters of the current frame
+  const Stats& stats() const { return stats_; }
+
+ private:
+  int frame_ = 0;
+  // 2 per object, 0 until first used
+  std::vector<unsigned int> queries_;
+  // Frame each object was last queried in
+  std::vector<int> query_frames_;
+  // Objects queried last frame and this frame
+  std::vector<int> queried_previous_;
+  std::vector<int> queried_current_;
+  bool conditional_ = false;
+  bool read_results_;
+  Stats stats_;
+};
+
+#endif
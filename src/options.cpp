@@ -0,0 +1,172 @@
+#include "options.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include "constants.h"
+
+Options::Options() : n_cubes(constants::nCubes) {}
+
+namespace {
+
+// Returns the value of "--name=value" if |arg| matches |name|, else NULL
+const char* matchValue(const char* arg, const char* name) {
+  size_t len = std::strlen(name);
+  if (std::strncmp(arg, name, len) == 0 && arg[len] == '=') {
+    return arg + len + 1;
+  }
+  return NULL;
+}
+
+const RenderMode RENDER_MODES[] = {PER_DRAW, INSTANCED, CONDITIONAL,
+                                   MULTI_DRAW_INDIRECT, GPU_CULL,
+                                   VERTEX_PULLING, GPU_ANIMATED};
+const VertexPacking VERTEX_PACKINGS[] = {VERTEX_FLOAT, VERTEX_HALF,
+                                         VERTEX_SNORM16};
+
+}  // namespace
+
+const char* renderModeName(RenderMode mode) {
+  switch (mode) {
+    case PER_DRAW:
+      return "per-draw";
+    case INSTANCED:
+      return "instanced";
+    case CONDITIONAL:
+      return "conditional";
+    case MULTI_DRAW_INDIRECT:
+      return "indirect";
+    case GPU_CULL:
+      return "gpu-cull";
+    case VERTEX_PULLING:
+      return "pulled";
+    case GPU_ANIMATED:
+      return "animated";
+  }
+  return "unknown";
+}
+
+const char* vertexPackingName(VertexPacking packing) {
+  switch (packing) {
+    case VERTEX_FLOAT:
+      return "float";
+    case VERTEX_HALF:
+      return "half";
+    case VERTEX_SNORM16:
+      return "snorm16";
+  }
+  return "unknown";
+}
+
+Options parseOptions(int argc, char** argv) {
+  Options options;
+  bool has_warmup = false;
+  bool has_seed = false;
+  for (int i = 1; i < argc; i++) {
+    const char* value;
+    if ((value = matchValue(argv[i], "--mode"))) {
+      bool known = false;
+      for (RenderMode mode : RENDER_MODES) {
+        if (std::strcmp(value, renderModeName(mode)) == 0) {
+          options.render_mode = mode;
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cout << "Unknown render mode: " << value << std::endl;
+      }
+    } else if ((value = matchValue(argv[i], "--cubes"))) {
+      int n = std::atoi(value);
+      if (n > 0) {
+        options.n_cubes = n;
+      } else {
+        std::cout << "Invalid cube count: " << value << std::endl;
+      }
+    } else if ((value = matchValue(argv[i], "--cull"))) {
+      if (std::strcmp(value, "off") == 0) {
+        options.cull = CULL_OFF;
+      } else if (std::strcmp(value, "frustum") == 0 ||
+                 std::strcmp(value, "on") == 0) {
+        options.cull = CULL_FRUSTUM;
+      } else if (std::strcmp(value, "bvh") == 0) {
+        options.cull = CULL_BVH;
+      } else {
+        std::cout << "Unknown cull mode: " << value << std::endl;
+      }
+    } else if ((value = matchValue(argv[i], "--occlusion"))) {
+      options.occlusion = std::strcmp(value, "off") != 0;
+    } else if ((value = matchValue(argv[i], "--persistent"))) {
+      options.persistent = std::strcmp(value, "off") != 0;
+    } else if ((value = matchValue(argv[i], "--frames-in-flight"))) {
+      int n = std::atoi(value);
+      if (n > 0) {
+        options.frames_in_flight = n;
+      } else {
+        std::cout << "Invalid frames in flight: " << value << std::endl;
+      }
+    } else if ((value = matchValue(argv[i], "--vertex-format"))) {
+      bool known = false;
+      for (VertexPacking packing : VERTEX_PACKINGS) {
+        if (std::strcmp(value, vertexPackingName(packing)) == 0) {
+          options.vertex_format = packing;
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cout << "Unknown vertex format: " << value << std::endl;
+      }
+    } else if ((value = matchValue(argv[i], "--threads"))) {
+      int n = std::atoi(value);
+      if (n >= 0) {
+        options.threads = n;
+      } else {
+        std::cout << "Invalid thread count: " << value << std::endl;
+      }
+    } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+      options.frames_in_flight = 1;
+    } else if (std::strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if ((value = matchValue(argv[i], "--frames"))) {
+      options.frames = std::atoi(value);
+    } else if ((value = matchValue(argv[i], "--screenshot"))) {
+      options.screenshot = value;
+    } else if (std::strcmp(argv[i], "--benchmark") == 0) {
+      options.benchmark = true;
+    } else if ((value = matchValue(argv[i], "--warmup"))) {
+      options.warmup_frames = std::max(0, std::atoi(value));
+      has_warmup = true;
+    } else if ((value = matchValue(argv[i], "--benchmark-output"))) {
+      options.benchmark_output = value;
+    } else if ((value = matchValue(argv[i], "--trace"))) {
+      options.trace = value;
+    } else if ((value = matchValue(argv[i], "--seed"))) {
+      options.seed = (unsigned int)std::strtoul(value, NULL, 10);
+      has_seed = true;
+    } else {
+      std::cout << "Ignoring unknown argument: " << argv[i] << std::endl;
+    }
+  }
+  if (options.benchmark) {
+    if (options.frames <= 0) {
+      options.frames = BENCHMARK_FRAMES;
+    }
+    if (!has_warmup) {
+      options.warmup_frames = BENCHMARK_WARMUP_FRAMES;
+    }
+    if (!has_seed) {
+      options.seed = BENCHMARK_SEED;
+    }
+  } else {
+    options.warmup_frames = 0;
+    if (!has_seed) {
+      options.seed = (unsigned int)std::time(NULL);
+    }
+  }
+  if (options.headless && options.frames <= 0) {
+    options.frames = HEADLESS_FRAMES;
+  }
+  return options;
+}
@@ -0,0 +1,123 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstddef>
+
+// Frames a headless run renders unless --frames says otherwise
+const int HEADLESS_FRAMES = 300;
+// --benchmark defaults
+const int BENCHMARK_WARMUP_FRAMES = 60;
+const int BENCHMARK_FRAMES = 600;
+const unsigned int BENCHMARK_SEED = 1;
+
+// Paths the cube scene can be submitted through
+enum RenderMode {
+  // One glDrawElements and one model matrix upload per cube
+  PER_DRAW = 0,
+  // All model matrices streamed into a per-instance buffer, one draw call
+  INSTANCED = 1,
+  // Per-draw, each draw conditional on an occlusion query of the cube's
+  // bounding box from the frame before
+  CONDITIONAL = 2,
+  // One glMultiDrawElementsIndirect per state change; each draw reads its
+  // model matrix from the instance buffer through its base instance.
+  // GL 4.3, falls back to PER_DRAW.
+  MULTI_DRAW_INDIRECT = 3,
+  // A compute shader culls the cubes and writes the survivors' model
+  // matrices and the instance count of one indirect draw; --cull and
+  // --occlusion are ignored. GL 4.3, falls back to INSTANCED.
+  GPU_CULL = 4,
+  // Instanced without vertex buffers: the shader builds the cube from
+  // gl_VertexID and animates it from a CubeInstance per cube, pulled from
+  // a buffer texture by gl_InstanceID
+  VERTEX_PULLING = 5,
+  // Every cube's CubeInstance uploaded once; the vertex shader rotates the
+  // cubes from the frame time. One instanced draw of all cubes per frame,
+  // no CPU work per cube: --cull and --occlusion are ignored.
+  GPU_ANIMATED = 6
+};
+
+// The --mode spelling of |mode|
+const char* renderModeName(RenderMode mode);
+
+// How cubes outside the view frustum are skipped
+enum CullMode {
+  CULL_OFF = 0,
+  // Every cube's bounding sphere tested against the frustum
+  CULL_FRUSTUM = 1,
+  // Frustum tested against a bounding volume hierarchy over the cubes
+  CULL_BVH = 2
+};
+
+// How the cube's vertices are stored
+enum VertexPacking {
+  // 3 float positions, 2 float texture coordinates: 20 bytes
+  VERTEX_FLOAT = 0,
+  // Half float positions, unorm16 texture coordinates: 12 bytes
+  VERTEX_HALF = 1,
+  // snorm16 positions, unorm16 texture coordinates: 12 bytes
+  VERTEX_SNORM16 = 2
+};
+
+// The --vertex-format spelling of |packing|
+const char* vertexPackingName(VertexPacking packing);
+
+// Run-time options, parsed from the command line
+struct Options {
+  RenderMode render_mode = INSTANCED;
+  int n_cubes;
+  CullMode cull = CULL_FRUSTUM;
+  // Also skip cubes hidden behind the nearest ones, tested on the CPU
+  bool occlusion = false;
+  // Stream instance matrices through a persistently mapped buffer (GL 4.4)
+  // rather than unsynchronized maps of an orphaned one
+  bool persistent = true;
+  // Frames the CPU may submit before the GPU finishes the oldest; 1 is the
+  // low-latency mode
+  int frames_in_flight = 2;
+  VertexPacking vertex_format = VERTEX_FLOAT;
+  // Threads culling and writing the instances, the render thread included;
+  // 0 means one per hardware thread
+  int threads = 0;
+  // Render offscreen through EGL instead of opening a window
+  bool headless = false;
+  // Frames to render before exiting; 0 runs until the window is closed.
+  // Headless runs default to HEADLESS_FRAMES.
+  int frames = 0;
+  // Headless only: PPM file the last frame is written to, or NULL
+  const char* screenshot = NULL;
+  // Fly a scripted camera path with a fixed timestep and report frame times
+  bool benchmark = false;
+  // Frames rendered before --frames starts counting; benchmark only
+  int warmup_frames = 0;
+  // Where the benchmark JSON goes; NULL prints it to stdout
+  const char* benchmark_output = NULL;
+  // Chrome trace of the CPU profiling zones is written here on exit, or NULL.
+  // Needs a LEARNOPENGL_PROFILE build.
+  const char* trace = NULL;
+  // Seed for the scene's random layout and rotation. Without --seed it is
+  // BENCHMARK_SEED for benchmarks and the clock otherwise.
+  unsigned int seed = 0;
+
+  Options();
+};
+
+// Accepts:
+//   --mode=per-draw|instanced|conditional|indirect|gpu-cull|pulled|animated
+//   --cubes=N
+//   --cull=off|frustum|bvh  (on is frustum)
+//   --occlusion=on|off
+//   --persistent=on|off
+//   --vertex-format=float|half|snorm16
+//   --threads=N  (0 is one per hardware thread)
+//   --frames-in-flight=N  --low-latency  (same as --frames-in-flight=1)
+//   --headless
+//   --frames=N
+//   --screenshot=FILE.ppm
+//   --benchmark  --warmup=N  --benchmark-output=FILE.json
+//   --seed=N
+//   --trace=FILE.json
+// Unknown arguments are reported and ignored.
+Options parseOptions(int argc, char** argv);
+
+#endif
@@ -0,0 +1,145 @@
+#include "profiler.h"
+
+#ifdef LEARNOPENGL_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profiler {
+
+namespace {
+
+// Zones kept per thread; older ones are overwritten
+const uint64_t BUFFER_CAPACITY = 1 << 16;
+
+enum EventType { ZONE, COUNTER };
+
+struct Event {
+  const char* name;
+  EventType type;
+  uint64_t begin_ns;
+  // Zones only
+  uint64_t end_ns;
+  // Counters only
+  double value;
+};
+
+// Written only by its owning thread. |count| is published with release
+// semantics after each event so a reader sees complete events.
+struct ThreadBuffer {
+  int tid = 0;
+  const char* name = NULL;
+  std::atomic<uint64_t> count{0};
+  std::unique_ptr<Event[]> events{new Event[BUFFER_CAPACITY]};
+};
+
+// Registry of every thread's buffer. The mutex is taken once per thread, on
+// its first zone, and by the exporter; never while recording.
+std::mutex REGISTRY_MUTEX;
+std::vector<std::unique_ptr<ThreadBuffer>> REGISTRY;
+
+ThreadBuffer& threadBuffer() {
+  thread_local ThreadBuffer* buffer = NULL;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(REGISTRY_MUTEX);
+    REGISTRY.push_back(std::make_unique<ThreadBuffer>());
+    buffer = REGISTRY.back().get();
+    buffer->tid = (int)REGISTRY.size();
+  }
+  return *buffer;
+}
+
+const uint64_t START_NS = now();
+
+void writeEscaped(FILE* file, const char* text) {
+  for (; *text; text++) {
+    if (*text == '"' || *text == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(*text, file);
+  }
+}
+
+}  // namespace
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+namespace {
+
+void append(const Event& event) {
+  ThreadBuffer& buffer = threadBuffer();
+  uint64_t index = buffer.count.load(std::memory_order_relaxed);
+  buffer.events[index % BUFFER_CAPACITY] = event;
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace
+
+void record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+  append({name, ZONE, begin_ns, end_ns, 0.0});
+}
+
+void counter(const char* name, double value) {
+  append({name, COUNTER, now(), 0, value});
+}
+
+void setThreadName(const char* name) {
+  threadBuffer().name = name;
+}
+
+bool writeChromeTrace(const char* path) {
+  FILE* file = std::fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool first = true;
+  std::lock_guard<std::mutex> lock(REGISTRY_MUTEX);
+  for (const std::unique_ptr<ThreadBuffer>& buffer : REGISTRY) {
+    if (buffer->name) {
+      std::fprintf(file,
+                   "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                   "\"tid\": %d, \"args\": {\"name\": \"",
+                   first ? "" : ",\n", buffer->tid);
+      writeEscaped(file, buffer->name);
+      std::fprintf(file, "\"}}");
+      first = false;
+    }
+    uint64_t count = buffer->count.load(std::memory_order_acquire);
+    uint64_t begin = count > BUFFER_CAPACITY ? count - BUFFER_CAPACITY : 0;
+    for (uint64_t i = begin; i < count; i++) {
+      const Event& event = buffer->events[i % BUFFER_CAPACITY];
+      std::fprintf(file, "%s{\"name\": \"", first ? "" : ",\n");
+      writeEscaped(file, event.name);
+      // Chrome wants microseconds
+      if (event.type == COUNTER) {
+        std::fprintf(file,
+                     "\", \"ph\": \"C\", \"pid\": 1, \"tid\": %d, "
+                     "\"ts\": %.3f, \"args\": {\"value\": %g}}",
+                     buffer->tid, (event.begin_ns - START_NS) / 1e3,
+                     event.value);
+      } else {
+        std::fprintf(file,
+                     "\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                     "\"ts\": %.3f, \"dur\": %.3f}",
+                     buffer->tid, (event.begin_ns - START_NS) / 1e3,
+                     (event.end_ns - event.begin_ns) / 1e3);
+      }
+      first = false;
+    }
+  }
+  std::fprintf(file, "\n]}\n");
+  return std::fclose(file) == 0;
+}
+
+}  // namespace profiler
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+
+// Scoped CPU profiling zones and counters, exported as Chrome trace_event
+// JSON (open in chrome://tracing or ui.perfetto.dev). Each thread records
+// into its own fixed-size ring, so recording takes no locks. Only built with
+// LEARNOPENGL_PROFILE; otherwise PROFILE_ZONE expands to nothing and the
+// functions below are empty inlines.
+//
+//   void update() {
+//     PROFILE_ZONE("update");
+//     ...
+//   }
+
+#ifdef LEARNOPENGL_PROFILE
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// Times the rest of the enclosing scope. |name| must be a string literal.
+#define PROFILE_ZONE(name) \
+  profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+namespace profiler {
+
+// Nanoseconds on the steady clock
+uint64_t now();
+
+// Appends a completed zone to the calling thread's buffer
+void record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+class Zone {
+ public:
+  explicit Zone(const char* name) : name_(name), begin_ns_(now()) {}
+  ~Zone() { record(name_, begin_ns_, now()); }
+  Zone(const Zone&) = delete;
+  Zone& operator=(const Zone&) = delete;
+
+ private:
+  const char* name_;
+  uint64_t begin_ns_;
+};
+
+// Samples counter |name|, drawn as a graph over time. |name| must be a
+// string literal.
+void counter(const char* name, double value);
+
+// Names the calling thread in the trace. |name| must be a string literal.
+void setThreadName(const char* name);
+
+// Writes every thread's zones to |path|. Zones recorded while this runs may
+// be missing, so call it once the profiled threads are idle. Returns false
+// on failure.
+bool writeChromeTrace(const char* path);
+
+}  // namespace profiler
+
+#else
+
+#define PROFILE_ZONE(name)
+
+namespace profiler {
+
+inline void counter(const char* name, double value) {}
+inline void setThreadName(const char* name) {}
+inline bool writeChromeTrace(const char* path) {
+  return false;
+}
+
+}  // namespace profiler
+
+#endif
+
+#endif
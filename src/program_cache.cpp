@@ -0,0 +1,159 @@
+#include "program_cache.h"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "gl_ext.h"
+
+namespace program_cache {
+
+namespace {
+
+const uint32_t MAGIC = 0x50424331;  // "PBC1"
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t key;
+  double compile_ms;
+  uint32_t length;
+};
+
+Stats STATS;
+
+// -1 until the first query, then 0 or 1
+int SUPPORTED = -1;
+
+bool supported() {
+  if (SUPPORTED < 0) {
+    SUPPORTED = gl_ext::hasProgramBinary() ? 1 : 0;
+  }
+  return SUPPORTED == 1;
+}
+
+uint64_t fnv1a(uint64_t hash, std::string_view bytes) {
+  for (char c : bytes) {
+    hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+  }
+  // separate consecutive fields so ("ab", "c") and ("a", "bc") differ
+  return (hash ^ 0xff) * 1099511628211ull;
+}
+
+std::string_view glString(GLenum name) {
+  const char* value = (const char*)glGetString(name);
+  return value ? value : "";
+}
+
+std::filesystem::path entryPath(uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+  return std::filesystem::path(DIRECTORY) / name;
+}
+
+}  // namespace
+
+uint64_t key(std::initializer_list<std::string_view> sources) {
+  uint64_t hash = 14695981039346656037ull;
+  for (std::string_view source : sources) {
+    hash = fnv1a(hash, source);
+  }
+  hash = fnv1a(hash, glString(GL_VENDOR));
+  hash = fnv1a(hash, glString(GL_RENDERER));
+  hash = fnv1a(hash, glString(GL_VERSION));
+  return hash;
+}
+
+bool load(unsigned int program, uint64_t key) {
+  if (!supported()) {
+    STATS.misses++;
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::filesystem::path path = entryPath(key);
+  std::ifstream file(path, std::ios::binary);
+  FileHeader header;
+  if (!file || !file.read((char*)&header, sizeof(header)) ||
+      header.magic != MAGIC || header.key != key) {
+    STATS.misses++;
+    return false;
+  }
+  // a damaged header must not size the allocation: the binary is exactly
+  // the rest of the file, as store() writes it
+  std::error_code error;
+  uintmax_t file_size = std::filesystem::file_size(path, error);
+  if (error || file_size != sizeof(header) + (uintmax_t)header.length) {
+    STATS.misses++;
+    return false;
+  }
+  std::vector<char> binary(header.length);
+  if (!file.read(binary.data(), binary.size())) {
+    STATS.misses++;
+    return false;
+  }
+
+  gl_ext::ProgramBinary(program, header.format, binary.data(), header.length);
+  int success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    // stale or corrupt entry; it gets overwritten after the source build
+    STATS.misses++;
+    STATS.rejected++;
+    return false;
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  STATS.hits++;
+  STATS.ms_saved += header.compile_ms - elapsed.count();
+  return true;
+}
+
+void store(unsigned int program, uint64_t key, double compile_ms) {
+  if (!supported()) {
+    return;
+  }
+  int length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  FileHeader header = {MAGIC, 0, key, compile_ms, 0};
+  std::vector<char> binary(length);
+  GLsizei written = 0;
+  gl_ext::GetProgramBinary(program, length, &written, &header.format,
+                           binary.data());
+  header.length = written;
+
+  std::error_code error;
+  std::filesystem::create_directories(DIRECTORY, error);
+  std::ofstream file(entryPath(key), std::ios::binary | std::ios::trunc);
+  file.write((const char*)&header, sizeof(header));
+  file.write(binary.data(), written);
+  if (!file) {
+    std::cout << "Failed to write program cache entry" << std::endl;
+  }
+}
+
+const Stats& stats() {
+  return STATS;
+}
+
+void printStats() {
+  std::cout << "Program cache: " << STATS.hits << " hit(s), " << STATS.misses
+            << " miss(es)";
+  if (STATS.rejected > 0) {
+    std::cout << " (" << STATS.rejected << " rejected by driver)";
+  }
+  std::cout << ", " << STATS.ms_saved << " ms compile time saved";
+  if (!supported()) {
+    std::cout << " [program binaries unsupported]";
+  }
+  std::cout << std::endl;
+}
+
+}  // namespace program_cache
@@ -0,0 +1,44 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+// On-disk cache of linked program binaries. Entries are keyed by the shader
+// sources plus the GL vendor, renderer and version, so a driver update or a
+// different GPU simply misses. Every failure falls back to compiling from
+// source; nothing here is fatal.
+namespace program_cache {
+
+// Directory holding one file per cached program
+const char* const DIRECTORY = "shader_cache";
+
+struct Stats {
+  int hits = 0;
+  int misses = 0;
+  // Binaries found on disk but refused by the driver
+  int rejected = 0;
+  // Compile + link time recorded when each hit was stored, minus the time it
+  // took to load it instead
+  double ms_saved = 0.0;
+};
+
+// Key for the program built from |sources| on the current context
+uint64_t key(std::initializer_list<std::string_view> sources);
+
+// Tries to restore |program| from the cache. Returns true if |program| is now
+// linked; otherwise |program| is untouched and must be built from source.
+bool load(unsigned int program, uint64_t key);
+
+// Saves the linked |program|. |compile_ms| is the time it took to build from
+// source and is what later hits report as saved.
+void store(unsigned int program, uint64_t key, double compile_ms);
+
+const Stats& stats();
+// Prints the hit/miss counts and the compile time saved so far
+void printStats();
+
+}  // namespace program_cache
+
+#endif
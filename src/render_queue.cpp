@@ -0,0 +1,94 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+#include "job_system.h"
+
+namespace {
+
+const int RADIX_BITS = 8;
+const int BUCKETS = 1 << RADIX_BITS;
+const int PASSES = 64 / RADIX_BITS;
+// Fewest commands per slice worth a job of their own
+const size_t MIN_COMMANDS_PER_SLICE = 1 << 14;
+
+}  // namespace
+
+uint64_t RenderQueue::makeKey(uint32_t program,
+                              uint32_t texture,
+                              uint32_t vao,
+                              float depth) {
+  const uint32_t max_depth = (1u << DEPTH_BITS) - 1;
+  uint32_t quantized =
+      (uint32_t)(std::min(std::max(depth, 0.0f), 1.0f) * max_depth);
+  uint64_t key = program & ((1u << PROGRAM_BITS) - 1);
+  key = (key << TEXTURE_BITS) | (texture & ((1u << TEXTURE_BITS) - 1));
+  key = (key << VAO_BITS) | (vao & ((1u << VAO_BITS) - 1));
+  key = (key << DEPTH_BITS) | quantized;
+  return key;
+}
+
+void RenderQueue::sort(JobSystem& jobs) {
+  const size_t count = commands_.size();
+  if (count < 2) {
+    return;
+  }
+  scratch_.resize(count);
+  const int slices = (int)std::max<size_t>(
+      1, std::min<size_t>(jobs.threads(), count / MIN_COMMANDS_PER_SLICE));
+
+  // Each slice is histogrammed and scattered by one job. The offset of
+  // digit d in slice s is the count of all smaller digits plus the count of
+  // d in slices before s, which keeps the sort stable.
+  std::vector<uint32_t> histograms((size_t)slices * BUCKETS);
+  std::vector<uint32_t> offsets((size_t)slices * BUCKETS);
+  RenderCommand* source = commands_.data();
+  RenderCommand* destination = scratch_.data();
+  int passes_done = 0;
+  for (int pass = 0; pass < PASSES; pass++) {
+    const int shift = pass * RADIX_BITS;
+    jobs.parallelFor(0, slices, 1, [&](int slice_begin, int slice_end) {
+      for (int slice = slice_begin; slice < slice_end; slice++) {
+        uint32_t* histogram = &histograms[(size_t)slice * BUCKETS];
+        std::fill(histogram, histogram + BUCKETS, 0);
+        for (size_t i = count * slice / slices,
+                    end = count * (slice + 1) / slices;
+             i < end; i++) {
+          histogram[(source[i].key >> shift) & (BUCKETS - 1)]++;
+        }
+      }
+    });
+
+    uint32_t total = 0;
+    bool shared_digit = false;
+    for (int digit = 0; digit < BUCKETS; digit++) {
+      uint32_t digit_total = 0;
+      for (int slice = 0; slice < slices; slice++) {
+        offsets[(size_t)slice * BUCKETS + digit] = total + digit_total;
+        digit_total += histograms[(size_t)slice * BUCKETS + digit];
+      }
+      shared_digit = shared_digit || digit_total == count;
+      total += digit_total;
+    }
+    if (shared_digit) {
+      continue;
+    }
+
+    jobs.parallelFor(0, slices, 1, [&](int slice_begin, int slice_end) {
+      for (int slice = slice_begin; slice < slice_end; slice++) {
+        uint32_t* offset = &offsets[(size_t)slice * BUCKETS];
+        for (size_t i = count * slice / slices,
+                    end = count * (slice + 1) / slices;
+             i < end; i++) {
+          destination[offset[(source[i].key >> shift) & (BUCKETS - 1)]++] =
+              source[i];
+        }
+      }
+    });
+    std::swap(source, destination);
+    passes_done++;
+  }
+  if (passes_done % 2) {
+    commands_.swap(scratch_);
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// A draw in the queue: its sort key and what to draw, an index into the
+// caller's own table
+struct RenderCommand {
+  uint64_t key;
+  uint32_t draw;
+};
+
+// Draws submitted as 64-bit keys and sorted before submission. From the
+// most significant bit down a key holds
+//
+//   program (12 bits) | texture (14) | VAO (14) | depth (24)
+//
+// so sorted draws come grouped by program, then texture, then VAO, and
+// front to back within a group for early depth rejection. The state fields
+// are slots in tables of the caller's, not GL names. The submitter walks the
+// sorted commands and changes only the state whose field differs from the
+// previous key.
+class RenderQueue {
+ public:
+  static const int PROGRAM_BITS = 12;
+  static const int TEXTURE_BITS = 14;
+  static const int VAO_BITS = 14;
+  static const int DEPTH_BITS = 24;
+
+  // |depth| is clamped to [0, 1]; 0 is nearest
+  static uint64_t makeKey(uint32_t program,
+                          uint32_t texture,
+                          uint32_t vao,
+                          float depth);
+  static uint32_t programOf(uint64_t key) {
+    return (uint32_t)(key >> (TEXTURE_BITS + VAO_BITS + DEPTH_BITS));
+  }
+  static uint32_t textureOf(uint64_t key) {
+    return (uint32_t)(key >> (VAO_BITS + DEPTH_BITS)) &
+           ((1u << TEXTURE_BITS) - 1);
+  }
+  static uint32_t vaoOf(uint64_t key) {
+    return (uint32_t)(key >> DEPTH_BITS) & ((1u << VAO_BITS) - 1);
+  }
+
+  void clear() { commands_.clear(); }
+  void reserve(size_t count) { commands_.reserve(count); }
+  void push(uint64_t key, uint32_t draw) { commands_.push_back({key, draw}); }
+
+  // Stable LSD radix sort on the keys, a byte per pass. Passes over bytes
+  // every key shares are skipped. Large queues are split into slices
+  // histogrammed and scattered in parallel on |jobs|.
+  void sort(JobSystem& jobs);
+
+  const std::vector<RenderCommand>& commands() const { return commands_; }
+
+ private:
+  std::vector<RenderCommand> commands_;
+  std::vector<RenderCommand> scratch_;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <glm/gtc/matrix_transform.hpp>
+
+float random_real(float x) {
+  return x * std::rand() / RAND_MAX;
+}
+
+glm::mat4 CubeScene::model(int i, float t) const {
+  glm::mat4 model = glm::mat4(1.0f);
+  model = glm::translate(model, position(i));
+  return glm::rotate(model, t * glm::radians(speed[i]), axis(i));
+}
+
+CubeInstance CubeScene::instance(int i) const {
+  return {glm::vec4(position(i), speed[i]),
+          glm::vec4(glm::normalize(axis(i)), 0.0f)};
+}
+
+CubeScene makeCubeScene(int n_cubes) {
+  // world space positions of our cubes
+  const glm::vec3 cubePositions[] = {
+      glm::vec3(0.0f, 0.0f, 0.0f),    glm::vec3(2.0f, 5.0f, -15.0f),
+      glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
+      glm::vec3(2.4f, -0.4f, -3.5f),  glm::vec3(-1.7f, 3.0f, -7.5f),
+      glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
+      glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f)};
+  const int n_classic = sizeof(cubePositions) / sizeof(cubePositions[0]);
+
+  CubeScene scene;
+  scene.x.resize(n_cubes);
+  scene.y.resize(n_cubes);
+  scene.z.resize(n_cubes);
+  scene.axis_x.resize(n_cubes);
+  scene.axis_y.resize(n_cubes);
+  scene.axis_z.resize(n_cubes);
+  scene.speed.resize(n_cubes);
+
+  // scatter any additional cubes in a field in front of the camera that grows
+  // with the cube count
+  const float field = 3.0f * std::cbrt((float)n_cubes);
+  scene.field = field;
+  for (int i = 0; i < n_cubes; i++) {
+    glm::vec3 position =
+        i < n_classic ? cubePositions[i]
+                      : glm::vec3(random_real(field) - field / 2,
+                                  random_real(field) - field / 2,
+                                  -random_real(field));
+    scene.x[i] = position.x;
+    scene.y[i] = position.y;
+    scene.z[i] = position.z;
+  }
+  for (int i = 0; i < n_cubes; i++) {
+    scene.axis_x[i] = random_real();
+    scene.axis_y[i] = random_real();
+    scene.axis_z[i] = random_real();
+    scene.speed[i] = random_real(360);
+  }
+  return scene;
+}
@@ -0,0 +1,48 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Radius of the sphere bounding a unit cube in any orientation, sqrt(3) / 2
+const float CUBE_RADIUS = 0.8660254f;
+
+// Uniform random number in [0, x], from std::rand so std::srand seeds it
+float random_real(float x = 1);
+
+// A cube as a shader animates it, rebuilding CubeScene::model() from the
+// time: two vec4s, so it maps onto RGBA32F texels and std430 arrays alike
+struct CubeInstance {
+  // xyz: world position, w: degrees per second
+  glm::vec4 position_speed;
+  // xyz: normalized rotation axis, w: unused
+  glm::vec4 axis;
+};
+
+// The rotating cubes, stored as structure of arrays so batched (SIMD)
+// kernels can stream each component
+struct CubeScene {
+  // World space positions
+  std::vector<float> x, y, z;
+  // Rotation axes (not normalized) and angular speed in degrees per second
+  std::vector<float> axis_x, axis_y, axis_z, speed;
+  // Edge length of the region the cubes are scattered in. It spans
+  // [-field / 2, field / 2] in x and y and [-field, 0] in z.
+  float field = 0.0f;
+
+  int size() const { return (int)x.size(); }
+  glm::vec3 position(int i) const { return glm::vec3(x[i], y[i], z[i]); }
+  glm::vec3 axis(int i) const {
+    return glm::vec3(axis_x[i], axis_y[i], axis_z[i]);
+  }
+  glm::vec3 center() const { return glm::vec3(0.0f, 0.0f, -field / 2); }
+  // Model matrix of cube |i| at time |t| seconds
+  glm::mat4 model(int i, float t) const;
+  CubeInstance instance(int i) const;
+};
+
+// The ten classic cube positions followed by |n_cubes| - 10 random ones in a
+// field that grows with the count, each with a random axis and speed
+CubeScene makeCubeScene(int n_cubes);
+
+#endif
@@ -1,59 +1,94 @@
 #include "shader.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string>
+
+#include "frame_uniforms.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "program_cache.h"
 
 Shader::Shader(const char* vertex_shader_file_path,
                const char* fragment_shader_file_path) {
   // 1. Extract shaders
-  std::string vertex_shader_source;
-  std::string fragment_shader_source;
-  std::ifstream vertex_shader_file;
-  std::ifstream fragment_shader_file;
+  std::string vertex_shader_source = readSource(vertex_shader_file_path);
+  std::string fragment_shader_source = readSource(fragment_shader_file_path);
 
-  // ensure ifstream objects can throw exceptions:
-  vertex_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fragment_shader_file.exceptions(std::ifstream::failbit |
-                                  std::ifstream::badbit);
+  const char* vertex_shader_source_ = vertex_shader_source.c_str();
+  const char* fragment_shader_source_ = fragment_shader_source.c_str();
 
-  try {
-    // Open shader files
-    vertex_shader_file.open(vertex_shader_file_path);
-    fragment_shader_file.open(fragment_shader_file_path);
+  // 2. Restore a previously linked binary if the cache has one
+  shader_program_ = glCreateProgram();
+  uint64_t cache_key =
+      program_cache::key({vertex_shader_source, fragment_shader_source});
+  if (!program_cache::load(shader_program_, cache_key)) {
+    buildProgram({{vertex_shader_source_, VERTEX},
+                  {fragment_shader_source_, FRAGMENT}},
+                 cache_key);
+  }
 
-    // Pass files to std::stringstream
-    std::stringstream vertex_shader_stream, fragment_shader_stream;
-    vertex_shader_stream << vertex_shader_file.rdbuf();
-    fragment_shader_stream << fragment_shader_file.rdbuf();
+  // 3. Cache uniform locations
+  reflectUniforms();
+}
 
-    // Close file handlers
-    vertex_shader_file.close();
-    fragment_shader_file.close();
+Shader::Shader(const char* compute_shader_file_path) {
+  std::string compute_shader_source = readSource(compute_shader_file_path);
+  shader_program_ = glCreateProgram();
+  uint64_t cache_key = program_cache::key({compute_shader_source});
+  if (!program_cache::load(shader_program_, cache_key)) {
+    buildProgram({{compute_shader_source.c_str(), COMPUTE}}, cache_key);
+  }
+  reflectUniforms();
+}
 
-    // Convert std::stringstream to std::string
-    vertex_shader_source = vertex_shader_stream.str();
-    fragment_shader_source = fragment_shader_stream.str();
+Shader::Shader(unsigned int linked_program) : shader_program_(linked_program) {
+  reflectUniforms();
+}
 
+std::string Shader::readSource(const char* file_path) {
+  std::ifstream file;
+  // ensure ifstream objects can throw exceptions:
+  file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  try {
+    // Pass file to std::stringstream
+    file.open(file_path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    file.close();
+    return stream.str();
   } catch (std::ifstream::failure& e) {
-    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what()
-              << std::endl;
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << file_path
+              << ": " << e.what() << std::endl;
     assert(false);
   }
+  return std::string();
+}
 
-  const char* vertex_shader_source_ = vertex_shader_source.c_str();
-  const char* fragment_shader_source_ = fragment_shader_source.c_str();
+void Shader::buildProgram(std::initializer_list<Stage> stages,
+                          uint64_t cache_key) {
+  auto start = std::chrono::steady_clock::now();
 
-  // 2. Compile shaders
-  unsigned int vertex_shader, fragment_shader;
-  compileShader(vertex_shader, vertex_shader_source_, ShaderType::VERTEX);
-  compileShader(fragment_shader, fragment_shader_source_, ShaderType::FRAGMENT);
+  // 1. Compile shaders
+  std::vector<unsigned int> shaders;
+  for (const Stage& stage : stages) {
+    unsigned int shader;
+    compileShader(shader, stage.source, stage.type);
+    shaders.push_back(shader);
+  }
 
-  // 3. Attach and link shader program
-  shader_program_ = glCreateProgram();
-  glAttachShader(shader_program_, vertex_shader);
-  glAttachShader(shader_program_, fragment_shader);
+  // 2. Attach and link shader program
+  for (unsigned int shader : shaders) {
+    glAttachShader(shader_program_, shader);
+  }
+  if (gl_ext::ProgramParameteri) {
+    gl_ext::ProgramParameteri(shader_program_,
+                              GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glLinkProgram(shader_program_);
 
   char infoLog[512];
@@ -66,9 +101,53 @@ Shader::Shader(const char* vertex_shader_file_path,
     assert(success);
   }
 
-  // 4. Delete shaders after linking
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
+  // 3. Delete shaders after linking
+  for (unsigned int shader : shaders) {
+    glDetachShader(shader_program_, shader);
+    glDeleteShader(shader);
+  }
+
+  // 4. Save the binary for the next launch
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  program_cache::store(shader_program_, cache_key, elapsed.count());
+}
+
+void Shader::reflectUniforms() {
+  // GLSL 330 cannot pick a block's binding itself, and a program binary
+  // restored from the cache starts from the defaults again
+  GLuint frame_block =
+      glGetUniformBlockIndex(shader_program_, FRAME_UNIFORMS_BLOCK);
+  if (frame_block != GL_INVALID_INDEX) {
+    glUniformBlockBinding(shader_program_, frame_block,
+                          FRAME_UNIFORMS_BINDING);
+  }
+
+  uniform_locations_.clear();
+  int n_uniforms = 0;
+  glGetProgramiv(shader_program_, GL_ACTIVE_UNIFORMS, &n_uniforms);
+  char name[256];
+  for (int i = 0; i < n_uniforms; i++) {
+    int length, size;
+    GLenum type;
+    glGetActiveUniform(shader_program_, i, sizeof(name), &length, &size, &type,
+                       name);
+    int location = glGetUniformLocation(shader_program_, name);
+    // members of uniform blocks have no location
+    if (location < 0) {
+      continue;
+    }
+    std::string_view key(name, length);
+    // arrays are reported as "name[0]"; also make them reachable as "name"
+    if (key.size() > 3 && key.substr(key.size() - 3) == "[0]") {
+      std::string_view array = key.substr(0, key.size() - 3);
+      uniform_locations_.push_back(
+          {hashUniformName(array), std::string(array), location});
+    }
+    uniform_locations_.push_back(
+        {hashUniformName(key), std::string(key), location});
+  }
+  std::sort(uniform_locations_.begin(), uniform_locations_.end());
 }
 
 void Shader::compileShader(unsigned int& shader,
@@ -81,6 +160,9 @@ void Shader::compileShader(unsigned int& shader,
     case FRAGMENT:
       shader = glCreateShader(GL_FRAGMENT_SHADER);
       break;
+    case COMPUTE:
+      shader = glCreateShader(GL_COMPUTE_SHADER);
+      break;
     default:
       assert(false);
       break;
@@ -95,7 +177,8 @@ void Shader::printShaderLogIfError(unsigned int shader,
   char info_log[1024];
   switch (type) {
     case VERTEX:
-    case FRAGMENT: {
+    case FRAGMENT:
+    case COMPUTE: {
       glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
       if (!success) {
         glGetShaderInfoLog(shader, 1024, NULL, info_log);
@@ -120,26 +203,71 @@ void Shader::printShaderLogIfError(unsigned int shader,
 }
 
 void Shader::use() {
-  glUseProgram(shader_program_);
+  gl_state::useProgram(shader_program_);
 }
 
 void Shader::Delete() {
   glDeleteProgram(shader_program_);
+  gl_state::programDeleted(shader_program_);
+}
+
+Shader::Uniform Shader::uniform(std::string_view name) const {
+  uint32_t hash = hashUniformName(name);
+  auto it = std::lower_bound(
+      uniform_locations_.begin(), uniform_locations_.end(), hash,
+      [](const UniformLocation& entry, uint32_t key) {
+        return entry.hash < key;
+      });
+  Uniform result;
+  for (; it != uniform_locations_.end() && it->hash == hash; ++it) {
+    if (it->name == name) {
+      result.location = it->location;
+      break;
+    }
+  }
+  return result;
+}
+
+void Shader::set_bool(std::string_view name, bool value) const {
+  set_bool(uniform(name), value);
+}
+
+void Shader::set_int(std::string_view name, int value) const {
+  set_int(uniform(name), value);
+}
+
+void Shader::set_float(std::string_view name, float value) const {
+  set_float(uniform(name), value);
+}
+
+void Shader::set_mat4(std::string_view name, const glm::mat4& mat) const {
+  set_mat4(uniform(name), mat);
+}
+
+void Shader::set_vec4(std::string_view name,
+                      const glm::vec4* values,
+                      int count) const {
+  set_vec4(uniform(name), values, count);
+}
+
+void Shader::set_bool(Uniform uniform, bool value) const {
+  glUniform1i(uniform.location, (int)value);
 }
 
-void Shader::set_bool(const std::string& name, bool value) const {
-  glUniform1i(glGetUniformLocation(shader_program_, name.c_str()), (int)value);
+void Shader::set_int(Uniform uniform, int value) const {
+  glUniform1i(uniform.location, value);
 }
 
-void Shader::set_int(const std::string& name, int value) const {
-  glUniform1i(glGetUniformLocation(shader_program_, name.c_str()), value);
+void Shader::set_float(Uniform uniform, float value) const {
+  glUniform1f(uniform.location, value);
 }
 
-void Shader::set_float(const std::string& name, float value) const {
-  glUniform1f(glGetUniformLocation(shader_program_, name.c_str()), value);
+void Shader::set_mat4(Uniform uniform, const glm::mat4& mat) const {
+  glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::set_mat4(const std::string& name, const glm::mat4& mat) const {
-  glUniformMatrix4fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                     GL_FALSE, &mat[0][0]);
+void Shader::set_vec4(Uniform uniform,
+                      const glm::vec4* values,
+                      int count) const {
+  glUniform4fv(uniform.location, count, &values[0][0]);
 }
\ No newline at end of file
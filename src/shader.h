@@ -4,34 +4,95 @@
 #include <glad/glad.h>  // include glad to get all the required OpenGL headers
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// FNV-1a hash of a uniform name. constexpr so names known at compile time can
+// be hashed by the compiler.
+constexpr uint32_t hashUniformName(std::string_view name) {
+  uint32_t hash = 2166136261u;
+  for (char c : name) {
+    hash = (hash ^ (uint8_t)c) * 16777619u;
+  }
+  return hash;
+}
 
 class Shader {
  public:
+  // Location of an active uniform. Resolve once with uniform() and reuse it in
+  // hot loops: setting through a handle does no lookup at all.
+  struct Uniform {
+    int location = -1;
+  };
+
   // constructor reads and builds the shader
   Shader(const char* vertex_shader_file_path,
          const char* fragment_shader_file_path);
+  // Reads and builds a compute program (GL 4.3)
+  explicit Shader(const char* compute_shader_file_path);
+  // Adopts a program that is already linked, e.g. by ShaderCompiler
+  explicit Shader(unsigned int linked_program);
+  // Returns the contents of a shader source file
+  static std::string readSource(const char* file_path);
   // Use/activate the shader
   void use();
   // Delete shader
   void Delete();
-  // Utility uniform functions
-  void set_bool(const std::string& name, bool value) const;
-  void set_int(const std::string& name, int value) const;
-  void set_float(const std::string& name, float value) const;
-  void set_mat4(const std::string& name, const glm::mat4& mat) const;
+  // Returns the handle of an active uniform, or one with location -1 (which GL
+  // silently ignores) if the program has no such uniform
+  Uniform uniform(std::string_view name) const;
+  // Utility uniform functions. The name overloads look the location up in the
+  // cache built after linking; they neither allocate nor call into the driver.
+  void set_bool(std::string_view name, bool value) const;
+  void set_int(std::string_view name, int value) const;
+  void set_float(std::string_view name, float value) const;
+  void set_mat4(std::string_view name, const glm::mat4& mat) const;
+  // Sets |count| consecutive elements of a vec4 array
+  void set_vec4(std::string_view name,
+                const glm::vec4* values,
+                int count = 1) const;
+  void set_bool(Uniform uniform, bool value) const;
+  void set_int(Uniform uniform, int value) const;
+  void set_float(Uniform uniform, float value) const;
+  void set_mat4(Uniform uniform, const glm::mat4& mat) const;
+  void set_vec4(Uniform uniform, const glm::vec4* values, int count = 1) const;
 
   unsigned int id() { return shader_program_; }
 
  private:
-  enum ShaderType { VERTEX = 0, FRAGMENT = 1, PROGRAM = 2 };
+  enum ShaderType { VERTEX = 0, FRAGMENT = 1, PROGRAM = 2, COMPUTE = 3 };
+  struct Stage {
+    const char* source;
+    ShaderType type;
+  };
+  // Compiles and links the program from the sources of its stages, then
+  // stores it in the program cache under |cache_key|
+  void buildProgram(std::initializer_list<Stage> stages, uint64_t cache_key);
   void compileShader(unsigned int& shader,
                      const char* source,
                      Shader::ShaderType type);
   void printShaderLogIfError(unsigned int shader,
                              Shader::ShaderType type) const;
+  // Queries every active uniform once and caches its location, and binds
+  // the FrameUniforms block if the program has one
+  void reflectUniforms();
   // Shader program ID
   unsigned int shader_program_;
+  // Sorted by hash, then name. The name is compared on lookup so a name the
+  // program lacks never resolves to another uniform that hashes alike.
+  struct UniformLocation {
+    uint32_t hash;
+    std::string name;
+    int location;
+    bool operator<(const UniformLocation& other) const {
+      return hash != other.hash ? hash < other.hash : name < other.name;
+    }
+  };
+  std::vector<UniformLocation> uniform_locations_;
 };
 
 #endif
\ No newline at end of file
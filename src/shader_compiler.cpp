@@ -0,0 +1,149 @@
+#include "shader_compiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "gl_ext.h"
+#include "program_cache.h"
+
+namespace {
+
+double nowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+unsigned int compileStage(GLenum type, const std::string& source) {
+  unsigned int shader = glCreateShader(type);
+  const char* source_ = source.c_str();
+  glShaderSource(shader, 1, &source_, NULL);
+  glCompileShader(shader);
+  return shader;
+}
+
+void printLogIfError(unsigned int shader) {
+  int success;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    char info_log[1024];
+    glGetShaderInfoLog(shader, 1024, NULL, info_log);
+    std::cout << "ERROR::SHADER::COMPILATION_FAILED: " << info_log
+              << std::endl;
+  }
+}
+
+}  // namespace
+
+bool ShaderCompiler::Handle::ready() const {
+  return job_ && job_->state != PENDING;
+}
+
+bool ShaderCompiler::Handle::failed() const {
+  return job_ && job_->state == FAILED;
+}
+
+Shader* ShaderCompiler::Handle::shader() const {
+  return job_ ? job_->shader.get() : NULL;
+}
+
+ShaderCompiler::ShaderCompiler()
+    : parallel_(gl_ext::MaxShaderCompilerThreadsKHR &&
+                gl_ext::hasParallelShaderCompile()) {
+  if (parallel_) {
+    // let the driver pick as many threads as it likes
+    gl_ext::MaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  }
+}
+
+ShaderCompiler::Handle ShaderCompiler::submit(
+    const char* vertex_shader_file_path,
+    const char* fragment_shader_file_path) {
+  std::string vertex_shader_source =
+      Shader::readSource(vertex_shader_file_path);
+  std::string fragment_shader_source =
+      Shader::readSource(fragment_shader_file_path);
+
+  auto job = std::make_shared<Job>();
+  job->program = glCreateProgram();
+  job->cache_key =
+      program_cache::key({vertex_shader_source, fragment_shader_source});
+  if (program_cache::load(job->program, job->cache_key)) {
+    job->shader = std::make_unique<Shader>(job->program);
+    job->state = DONE;
+    return Handle(job);
+  }
+
+  // Kick off compile and link without querying any status, which is what
+  // would block
+  job->submit_time = nowMs();
+  job->vertex_shader = compileStage(GL_VERTEX_SHADER, vertex_shader_source);
+  job->fragment_shader =
+      compileStage(GL_FRAGMENT_SHADER, fragment_shader_source);
+  glAttachShader(job->program, job->vertex_shader);
+  glAttachShader(job->program, job->fragment_shader);
+  if (gl_ext::ProgramParameteri) {
+    gl_ext::ProgramParameteri(job->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                              GL_TRUE);
+  }
+  glLinkProgram(job->program);
+  pending_.push_back(job);
+  return Handle(job);
+}
+
+void ShaderCompiler::poll() {
+  for (size_t i = 0; i < pending_.size();) {
+    Job& job = *pending_[i];
+    if (parallel_) {
+      int done = GL_FALSE;
+      glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &done);
+      if (!done) {
+        i++;
+        continue;
+      }
+    }
+    complete(job);
+    pending_.erase(pending_.begin() + i);
+    if (!parallel_) {
+      // every completion blocks; take one per frame
+      return;
+    }
+  }
+}
+
+void ShaderCompiler::finish() {
+  for (std::shared_ptr<Job>& job : pending_) {
+    complete(*job);
+  }
+  pending_.clear();
+}
+
+void ShaderCompiler::complete(Job& job) {
+  int success;
+  glGetProgramiv(job.program, GL_LINK_STATUS, &success);
+  if (!success) {
+    printLogIfError(job.vertex_shader);
+    printLogIfError(job.fragment_shader);
+    char info_log[1024];
+    glGetProgramInfoLog(job.program, 1024, NULL, info_log);
+    std::cout << "ERROR::SHADER_PROGRAM::LINKING_ERROR\n"
+              << info_log << std::endl;
+  }
+  glDetachShader(job.program, job.vertex_shader);
+  glDetachShader(job.program, job.fragment_shader);
+  glDeleteShader(job.vertex_shader);
+  glDeleteShader(job.fragment_shader);
+
+  if (success) {
+    // wall time since submit; with parallel compile this includes frames the
+    // program spent waiting to be polled, so it is an upper bound
+    program_cache::store(job.program, job.cache_key,
+                         nowMs() - job.submit_time);
+    job.shader = std::make_unique<Shader>(job.program);
+    job.state = DONE;
+  } else {
+    glDeleteProgram(job.program);
+    job.state = FAILED;
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+// Compiles and links programs in the background so submitting one never
+// stalls the render loop. With GL_KHR_parallel_shader_compile the driver
+// compiles on its own threads and completion is polled through
+// GL_COMPLETION_STATUS_KHR. Without it, poll() finishes at most one program
+// per call, so the unavoidable stalls are spread over several frames.
+class ShaderCompiler {
+ private:
+  struct Job;
+
+ public:
+  // Pollable result of submit(). Cheap to copy.
+  class Handle {
+   public:
+    Handle() = default;
+    // True once the program finished compiling, successfully or not
+    bool ready() const;
+    // True if compiling or linking failed; the log has been printed
+    bool failed() const;
+    // The linked program, or NULL until ready() and not failed()
+    Shader* shader() const;
+
+   private:
+    friend class ShaderCompiler;
+    explicit Handle(std::shared_ptr<Job> job) : job_(std::move(job)) {}
+    std::shared_ptr<Job> job_;
+  };
+
+  ShaderCompiler();
+
+  // Queues the program built from the two files. Restored synchronously if
+  // the program cache has it, which is just as cheap.
+  Handle submit(const char* vertex_shader_file_path,
+                const char* fragment_shader_file_path);
+  // Finishes whatever has completed since the last call
+  void poll();
+  // Blocks until every submitted program is ready
+  void finish();
+  // Number of programs still compiling
+  int pending() const { return (int)pending_.size(); }
+
+ private:
+  enum JobState { PENDING, DONE, FAILED };
+
+  struct Job {
+    JobState state = PENDING;
+    unsigned int program = 0;
+    unsigned int vertex_shader = 0;
+    unsigned int fragment_shader = 0;
+    uint64_t cache_key = 0;
+    double submit_time = 0.0;
+    std::unique_ptr<Shader> shader;
+  };
+
+  // Checks the link status of a job whose compilation completed
+  void complete(Job& job);
+
+  bool parallel_;
+  std::vector<std::shared_ptr<Job>> pending_;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+// Drawn while the real program is still compiling: flat grey, darkened
+// towards the edges so the cube faces stay readable
+void main() {
+    vec2 edge = min(TexCoord, 1.0 - TexCoord);
+    float shade = 0.4 + 0.3 * smoothstep(0.0, 0.1, min(edge.x, edge.y));
+    FragColor = vec4(vec3(shade), 1.0);
+}
@@ -0,0 +1,58 @@
+#version 330 core
+// Vertex pulling: no vertex attributes at all. The cube's corners and
+// texture coordinates come from gl_VertexID, and each instance's position,
+// axis and speed are fetched by gl_InstanceID from a buffer texture.
+// Draw 36 vertices per instance with an empty VAO bound.
+
+out vec2 TexCoord;
+
+// shared by every program, see frame_uniforms.h
+layout (std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec4 viewport;
+    float time;
+};
+
+// CubeInstance records (scene.h), two RGBA32F texels each
+uniform samplerBuffer instances;
+// texel of the draw's first instance
+uniform int instance_base;
+
+// the two triangles of a face, as corners of its unit square
+const int QUAD[6] = int[6](0, 1, 2, 2, 3, 0);
+
+// glm::rotate(mat4(1), angle, axis) for a normalized axis
+mat3 rotation(vec3 a, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 t = (1.0 - c) * a;
+    return mat3(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y,
+                t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x,
+                t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z);
+}
+
+void main()
+{
+    // faces in -x, +x, -y, +y, -z, +z order
+    int face = gl_VertexID / 6;
+    int corner = QUAD[gl_VertexID % 6];
+    vec2 uv = vec2(corner == 1 || corner == 2 ? 1.0 : 0.0,
+                   corner >= 2 ? 1.0 : 0.0);
+    vec2 p = uv - 0.5;
+    float side = (face & 1) == 0 ? -0.5 : 0.5;
+    int axis = face >> 1;
+    vec3 local = axis == 0 ? vec3(side, p.x, p.y)
+               : axis == 1 ? vec3(p.x, side, p.y)
+                           : vec3(p.x, p.y, side);
+
+    int texel = instance_base + 2 * gl_InstanceID;
+    vec4 position_speed = texelFetch(instances, texel);
+    vec3 rotation_axis = texelFetch(instances, texel + 1).xyz;
+    mat3 r = rotation(rotation_axis, time * radians(position_speed.w));
+    vec3 world = r * local + position_speed.xyz;
+
+    gl_Position = projection * view * vec4(world, 1.0);
+    TexCoord = vec2(uv.x, 1.0 - uv.y);
+}
@@ -1,15 +1,49 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+// per-instance model matrix, occupies locations 2..5
+layout (location = 2) in mat4 aInstanceModel;
+// per-instance CubeInstance (scene.h), animated here
+layout (location = 6) in vec4 aPositionSpeed;
+layout (location = 7) in vec4 aAxis;
 
 out vec2 TexCoord;
 
+// shared by every program, see frame_uniforms.h
+layout (std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec4 viewport;
+    float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// true when drawing with glDrawArraysInstanced
+uniform bool instanced;
+// true when the instances are CubeInstances rather than matrices
+uniform bool animated;
+
+// glm::rotate(mat4(1), angle, axis) for a normalized axis
+mat3 rotation(vec3 a, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 t = (1.0 - c) * a;
+    return mat3(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y,
+                t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x,
+                t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z);
+}
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    mat4 world;
+    if (animated) {
+        // CubeScene::model(i, time)
+        world = mat4(rotation(aAxis.xyz, time * radians(aPositionSpeed.w)));
+        world[3] = vec4(aPositionSpeed.xyz, 1.0);
+    } else {
+        world = instanced ? aInstanceModel : model;
+    }
+    gl_Position = projection * view * world * vec4(aPos, 1.0f);
     TexCoord = vec2(aTexCoord.x, 1.0 - aTexCoord.y);
-}
\ No newline at end of file
+}
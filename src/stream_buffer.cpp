@@ -0,0 +1,119 @@
+#include "stream_buffer.h"
+
+#include <chrono>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+
+namespace {
+
+// Regions start at multiples of this, enough for any uniform buffer offset
+// alignment seen in practice
+const size_t REGION_ALIGNMENT = 256;
+// glClientWaitSync timeout per try, in nanoseconds
+const GLuint64 WAIT_TIMEOUT = 1000000;
+
+size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+StreamBuffer::StreamBuffer(size_t region_size, int regions, bool persistent)
+    : region_size_(alignUp(region_size, REGION_ALIGNMENT)),
+      n_regions_(regions),
+      persistent_(persistent && gl_ext::hasBufferStorage()),
+      fences_(regions, (GLsync)0) {
+  const size_t size = region_size_ * n_regions_;
+  glGenBuffers(1, &buffer_);
+  // a target no draw reads from, so creating the buffer disturbs nothing
+  gl_state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  if (persistent_) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    gl_ext::BufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+    mapped_ =
+        (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+  }
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync fence : fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  if (mapped_) {
+    gl_state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  glDeleteBuffers(1, &buffer_);
+  gl_state::bufferDeleted(buffer_);
+}
+
+void StreamBuffer::beginFrame() {
+  region_ = (region_ + 1) % n_regions_;
+  used_ = 0;
+  last_wait_ms_ = 0.0;
+  if (persistent_) {
+    GLsync& fence = fences_[region_];
+    if (fence) {
+      auto start = std::chrono::steady_clock::now();
+      GLenum status = GL_TIMEOUT_EXPIRED;
+      while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  WAIT_TIMEOUT);
+      }
+      last_wait_ms_ = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+      glDeleteSync(fence);
+      fence = 0;
+    }
+    return;
+  }
+
+  gl_state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  if (region_ == 0) {
+    // orphan: frames in flight keep the old storage
+    glBufferData(GL_COPY_WRITE_BUFFER, region_size_ * n_regions_, NULL,
+                 GL_STREAM_DRAW);
+  }
+  mapped_ = (char*)glMapBufferRange(
+      GL_COPY_WRITE_BUFFER, region_ * region_size_, region_size_,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size,
+                                                size_t alignment) {
+  Allocation allocation;
+  size_t begin = alignUp(used_, alignment);
+  if (!mapped_ || region_ < 0 || begin + size > region_size_) {
+    return allocation;
+  }
+  used_ = begin + size;
+  allocation.offset = region_ * region_size_ + begin;
+  allocation.data =
+      persistent_ ? mapped_ + allocation.offset : mapped_ + begin;
+  return allocation;
+}
+
+void StreamBuffer::flush() {
+  // coherent persistent writes are visible to commands issued after them
+  if (persistent_ || !mapped_) {
+    return;
+  }
+  gl_state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  mapped_ = NULL;
+}
+
+void StreamBuffer::endFrame() {
+  flush();
+  if (persistent_) {
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <glad/glad.h>
+#include <vector>
+
+// Ring buffer for data written by the CPU once per frame and read by the GPU
+// in the same frame: instance attributes, uniform blocks, debug geometry.
+//
+// The buffer is split into one region per frame in flight. With GL 4.4
+// buffer storage it is mapped once, persistently and coherently, and the
+// CPU writes straight into the memory the GPU reads, with no driver copy. A
+// fence placed at endFrame() guards each region; beginFrame() waits on it
+// before the region is reused, which only blocks if the GPU is that many
+// frames behind.
+//
+// Without buffer storage each frame maps its region with
+// GL_MAP_UNSYNCHRONIZED_BIT, which never waits either since no earlier
+// frame wrote there. Once the ring wraps the storage is orphaned: the
+// driver hands out fresh memory while frames still reading the old one
+// finish with it.
+//
+//   stream.beginFrame();
+//   StreamBuffer::Allocation a = stream.allocate(bytes, alignment);
+//   write bytes to a.data
+//   stream.flush();
+//   bind stream.buffer() at a.offset and draw
+//   stream.endFrame();
+class StreamBuffer {
+ public:
+  // Where an allocation lives: |data| is the CPU pointer to write through,
+  // |offset| the byte offset in buffer() to bind or point attributes at.
+  // |data| is NULL if the frame's region is full or could not be mapped.
+  struct Allocation {
+    void* data = NULL;
+    size_t offset = 0;
+  };
+
+  // |region_size| bytes per frame, |regions| frames in flight. Uses buffer
+  // storage when |persistent| is set and the context supports it.
+  StreamBuffer(size_t region_size, int regions, bool persistent);
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+  // Makes the next region current, waiting until the GPU is done with it
+  void beginFrame();
+  // |size| bytes of the current region, |alignment| (a power of two) aligned
+  // in the buffer
+  Allocation allocate(size_t size, size_t alignment = 16);
+  // Ends this frame's writes; draws may read the allocations afterwards
+  void flush();
+  // Fences the region after the frame's last draw reading it
+  void endFrame();
+
+  GLuint buffer() const { return buffer_; }
+  size_t regionSize() const { return region_size_; }
+  // True if mapped persistently, false on the orphaning path
+  bool persistent() const { return persistent_; }
+  // Time beginFrame() spent waiting for the GPU, in milliseconds
+  double lastWaitMs() const { return last_wait_ms_; }
+
+ private:
+  GLuint buffer_ = 0;
+  size_t region_size_;
+  int n_regions_;
+  bool persistent_;
+  // Persistent: the whole buffer. Orphaning: the current region while
+  // mapped, else NULL.
+  char* mapped_ = NULL;
+  int region_ = -1;
+  // Bytes of the current region handed out
+  size_t used_ = 0;
+  // Persistent only, one per region; 0 when the region is not in flight
+  std::vector<GLsync> fences_;
+  double last_wait_ms_ = 0.0;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "transforms.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#define TRANSFORMS_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORMS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// glm::radians
+const float DEGREES_TO_RADIANS = 0.01745329251994329577f;
+const float TWO_OVER_PI = 0.636619772367581343f;
+// pi / 2 split so that j * PIO2_1 and j * PIO2_2 are exact (Cody & Waite)
+const float PIO2_1 = 1.5703125f;
+const float PIO2_2 = 4.837512969970703125e-4f;
+const float PIO2_3 = 7.54978995489188216e-8f;
+// Minimax polynomials on [-pi/4, pi/4] (Cephes sinf, cosf)
+const float SIN_1 = -1.6666654611e-1f;
+const float SIN_2 = 8.3321608736e-3f;
+const float SIN_3 = -1.9515295891e-4f;
+const float COS_1 = 4.166664568298827e-2f;
+const float COS_2 = -1.388731625493765e-3f;
+const float COS_3 = 2.443315711809948e-5f;
+
+// The kernel below is written once against these lane types: float, and
+// with SSE2 or AVX2 a wrapper holding four or eight floats with the same
+// arithmetic operators.
+
+// sin and cos of |x| through the polynomials, with the quadrant of x
+// selecting and negating them
+void sinCos(float x, float* sine, float* cosine) {
+  float j = std::nearbyint(x * TWO_OVER_PI);
+  float r = ((x - j * PIO2_1) - j * PIO2_2) - j * PIO2_3;
+  float r2 = r * r;
+  float s = r + r * r2 * (SIN_1 + r2 * (SIN_2 + r2 * SIN_3));
+  float c = 1.0f - 0.5f * r2 + r2 * r2 * (COS_1 + r2 * (COS_2 + r2 * COS_3));
+  int quadrant = (int)j;
+  if (quadrant & 1) {
+    float swap = s;
+    s = c;
+    c = swap;
+  }
+  *sine = quadrant & 2 ? -s : s;
+  *cosine = (quadrant + 1) & 2 ? -c : c;
+}
+
+float loadLanes(const float* data, const int* cubes, int i, float) {
+  return data[cubes ? cubes[i] : i];
+}
+
+// |m| holds the 16 elements column by column
+void storeLanes(const float (&m)[16], glm::mat4* out) {
+  float* destination = &(*out)[0][0];
+  for (int e = 0; e < 16; e++) {
+    destination[e] = m[e];
+  }
+}
+
+#ifdef TRANSFORMS_SSE
+struct Lanes4 {
+  static const int WIDTH = 4;
+  __m128 v;
+  Lanes4() {}
+  Lanes4(float value) : v(_mm_set1_ps(value)) {}
+  explicit Lanes4(__m128 value) : v(value) {}
+};
+inline Lanes4 operator+(Lanes4 a, Lanes4 b) {
+  return Lanes4(_mm_add_ps(a.v, b.v));
+}
+inline Lanes4 operator-(Lanes4 a, Lanes4 b) {
+  return Lanes4(_mm_sub_ps(a.v, b.v));
+}
+inline Lanes4 operator*(Lanes4 a, Lanes4 b) {
+  return Lanes4(_mm_mul_ps(a.v, b.v));
+}
+inline Lanes4 operator/(Lanes4 a, Lanes4 b) {
+  return Lanes4(_mm_div_ps(a.v, b.v));
+}
+inline Lanes4 sqrt(Lanes4 a) {
+  return Lanes4(_mm_sqrt_ps(a.v));
+}
+
+void sinCos(Lanes4 x, Lanes4* sine, Lanes4* cosine) {
+  // rounds to nearest under the default MXCSR mode
+  __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x.v, _mm_set1_ps(TWO_OVER_PI)));
+  Lanes4 j(_mm_cvtepi32_ps(quadrant));
+  Lanes4 r = ((x - j * PIO2_1) - j * PIO2_2) - j * PIO2_3;
+  Lanes4 r2 = r * r;
+  Lanes4 s = r + r * r2 * (SIN_1 + r2 * (SIN_2 + r2 * SIN_3));
+  Lanes4 c = Lanes4(1.0f) - Lanes4(0.5f) * r2 +
+             r2 * r2 * (COS_1 + r2 * (COS_2 + r2 * COS_3));
+
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+  __m128 swap = _mm_castsi128_ps(
+      _mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+  // bit 1 of the quadrant moved to the sign bit
+  __m128 sine_sign =
+      _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+  __m128 cosine_sign = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+  __m128 sine_value =
+      _mm_or_ps(_mm_and_ps(swap, c.v), _mm_andnot_ps(swap, s.v));
+  __m128 cosine_value =
+      _mm_or_ps(_mm_and_ps(swap, s.v), _mm_andnot_ps(swap, c.v));
+  sine->v = _mm_xor_ps(sine_value, sine_sign);
+  cosine->v = _mm_xor_ps(cosine_value, cosine_sign);
+}
+
+Lanes4 loadLanes(const float* data, const int* cubes, int i, Lanes4) {
+  if (!cubes) {
+    return Lanes4(_mm_loadu_ps(data + i));
+  }
+  return Lanes4(_mm_setr_ps(data[cubes[i]], data[cubes[i + 1]],
+                            data[cubes[i + 2]], data[cubes[i + 3]]));
+}
+
+// Column |column| of four matrices, one row per vector, written lane by
+// lane
+inline void storeColumn(__m128 r0,
+                        __m128 r1,
+                        __m128 r2,
+                        __m128 r3,
+                        int column,
+                        glm::mat4* out) {
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(&out[0][column][0], r0);
+  _mm_storeu_ps(&out[1][column][0], r1);
+  _mm_storeu_ps(&out[2][column][0], r2);
+  _mm_storeu_ps(&out[3][column][0], r3);
+}
+
+void storeLanes(const Lanes4 (&m)[16], glm::mat4* out) {
+  for (int column = 0; column < 4; column++) {
+    const Lanes4* rows = &m[4 * column];
+    storeColumn(rows[0].v, rows[1].v, rows[2].v, rows[3].v, column, out);
+  }
+}
+#endif
+
+#ifdef TRANSFORMS_AVX2
+struct Lanes8 {
+  static const int WIDTH = 8;
+  __m256 v;
+  Lanes8() {}
+  Lanes8(float value) : v(_mm256_set1_ps(value)) {}
+  explicit Lanes8(__m256 value) : v(value) {}
+};
+inline Lanes8 operator+(Lanes8 a, Lanes8 b) {
+  return Lanes8(_mm256_add_ps(a.v, b.v));
+}
+inline Lanes8 operator-(Lanes8 a, Lanes8 b) {
+  return Lanes8(_mm256_sub_ps(a.v, b.v));
+}
+inline Lanes8 operator*(Lanes8 a, Lanes8 b) {
+  return Lanes8(_mm256_mul_ps(a.v, b.v));
+}
+inline Lanes8 operator/(Lanes8 a, Lanes8 b) {
+  return Lanes8(_mm256_div_ps(a.v, b.v));
+}
+inline Lanes8 sqrt(Lanes8 a) {
+  return Lanes8(_mm256_sqrt_ps(a.v));
+}
+
+void sinCos(Lanes8 x, Lanes8* sine, Lanes8* cosine) {
+  __m256i quadrant =
+      _mm256_cvtps_epi32(_mm256_mul_ps(x.v, _mm256_set1_ps(TWO_OVER_PI)));
+  Lanes8 j(_mm256_cvtepi32_ps(quadrant));
+  Lanes8 r = ((x - j * PIO2_1) - j * PIO2_2) - j * PIO2_3;
+  Lanes8 r2 = r * r;
+  Lanes8 s = r + r * r2 * (SIN_1 + r2 * (SIN_2 + r2 * SIN_3));
+  Lanes8 c = Lanes8(1.0f) - Lanes8(0.5f) * r2 +
+             r2 * r2 * (COS_1 + r2 * (COS_2 + r2 * COS_3));
+
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  __m256 swap = _mm256_castsi256_ps(
+      _mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+  __m256 sine_sign = _mm256_castsi256_ps(
+      _mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+  __m256 cosine_sign = _mm256_castsi256_ps(_mm256_slli_epi32(
+      _mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+  sine->v = _mm256_xor_ps(_mm256_blendv_ps(s.v, c.v, swap), sine_sign);
+  cosine->v = _mm256_xor_ps(_mm256_blendv_ps(c.v, s.v, swap), cosine_sign);
+}
+
+Lanes8 loadLanes(const float* data, const int* cubes, int i, Lanes8) {
+  if (!cubes) {
+    return Lanes8(_mm256_loadu_ps(data + i));
+  }
+  __m256i index = _mm256_loadu_si256((const __m256i*)(cubes + i));
+  return Lanes8(_mm256_i32gather_ps(data, index, 4));
+}
+
+void storeLanes(const Lanes8 (&m)[16], glm::mat4* out) {
+  // the low and high halves are two groups of four matrices
+  for (int column = 0; column < 4; column++) {
+    const Lanes8* rows = &m[4 * column];
+    storeColumn(_mm256_castps256_ps128(rows[0].v),
+                _mm256_castps256_ps128(rows[1].v),
+                _mm256_castps256_ps128(rows[2].v),
+                _mm256_castps256_ps128(rows[3].v), column, out);
+    storeColumn(_mm256_extractf128_ps(rows[0].v, 1),
+                _mm256_extractf128_ps(rows[1].v, 1),
+                _mm256_extractf128_ps(rows[2].v, 1),
+                _mm256_extractf128_ps(rows[3].v, 1), column, out + 4);
+  }
+}
+#endif
+
+// Cubes [begin, end) in steps of |V|'s width; returns where it stopped
+template <class V, int WIDTH>
+int composeLanes(const CubeScene& scene,
+                 const int* cubes,
+                 int begin,
+                 int end,
+                 float time,
+                 glm::mat4* models) {
+  using std::sqrt;
+  const V zero(0.0f);
+  const V one(1.0f);
+  int i = begin;
+  for (; i + WIDTH <= end; i += WIDTH) {
+    V x = loadLanes(scene.x.data(), cubes, i, zero);
+    V y = loadLanes(scene.y.data(), cubes, i, zero);
+    V z = loadLanes(scene.z.data(), cubes, i, zero);
+    V ax = loadLanes(scene.axis_x.data(), cubes, i, zero);
+    V ay = loadLanes(scene.axis_y.data(), cubes, i, zero);
+    V az = loadLanes(scene.axis_z.data(), cubes, i, zero);
+    V speed = loadLanes(scene.speed.data(), cubes, i, zero);
+
+    // glm::rotate's order of operations, so the results agree
+    V angle = V(time) * (speed * V(DEGREES_TO_RADIANS));
+    V inverse_length = one / sqrt(ax * ax + ay * ay + az * az);
+    ax = ax * inverse_length;
+    ay = ay * inverse_length;
+    az = az * inverse_length;
+    V s, c;
+    sinCos(angle, &s, &c);
+    V one_minus_c = one - c;
+    V tx = one_minus_c * ax;
+    V ty = one_minus_c * ay;
+    V tz = one_minus_c * az;
+
+    const V m[16] = {c + tx * ax,      tx * ay + s * az, tx * az - s * ay,
+                     zero,             ty * ax - s * az, c + ty * ay,
+                     ty * az + s * ax, zero,             tz * ax + s * ay,
+                     tz * ay - s * ax, c + tz * az,      zero,
+                     x,                y,                z,
+                     one};
+    storeLanes(m, models + i);
+  }
+  return i;
+}
+
+}  // namespace
+
+void composeModelMatrices(const CubeScene& scene,
+                          const int* cubes,
+                          int count,
+                          float time,
+                          glm::mat4* models) {
+  int i = 0;
+#if defined(TRANSFORMS_AVX2)
+  i = composeLanes<Lanes8, 8>(scene, cubes, i, count, time, models);
+#endif
+#if defined(TRANSFORMS_SSE)
+  i = composeLanes<Lanes4, 4>(scene, cubes, i, count, time, models);
+#endif
+  composeLanes<float, 1>(scene, cubes, i, count, time, models);
+}
+
+const char* transformKernelIsa() {
+#if defined(TRANSFORMS_AVX2)
+  return "avx2";
+#elif defined(TRANSFORMS_SSE)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
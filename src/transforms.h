@@ -0,0 +1,27 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include <glm/glm.hpp>
+
+#include "scene.h"
+
+// Batched CubeScene::model(): writes the model matrix of cube cubes[i] at
+// |time| seconds to models[i] for i < |count|, or of cube i when |cubes| is
+// NULL. Matches glm::translate followed by glm::rotate to a few ULPs.
+//
+// Eight cubes at a time with AVX2 (a LEARNOPENGL_AVX2 build), four with
+// SSE2, else one by one; sine and cosine are evaluated with the same
+// polynomials in every case. Angles stay accurate up to about 1e5 radians.
+// All paths give the same bits (transforms.cpp is built without contracting
+// multiply-adds), so results do not depend on how a batch is split.
+void composeModelMatrices(const CubeScene& scene,
+                          const int* cubes,
+                          int count,
+                          float time,
+                          glm::mat4* models);
+
+// "avx2", "sse2" or "scalar": the widest path composeModelMatrices() was
+// built with
+const char* transformKernelIsa();
+
+#endif
@@ -0,0 +1,201 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Round to nearest, ties to even, as the GPU converts: |half| is |bits|
+// truncated by |shift| bits, rounded up when the first bit dropped is set
+// and either a later one is or |half| is odd
+bool roundsUp(uint32_t bits, int shift, uint32_t half) {
+  const uint32_t guard = 1u << (shift - 1);
+  return (bits & guard) && ((bits & (guard - 1)) || (half & 1));
+}
+
+int16_t toSnorm16(float value) {
+  return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+uint16_t toUnorm16(float value) {
+  return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+uint32_t toSnorm10(float value) {
+  return (uint32_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 511.0f) &
+         0x3ff;
+}
+
+// Writes the packed form of one attribute
+void packAttribute(const VertexAttribute& attribute,
+                   const float* in,
+                   unsigned char* out) {
+  switch (attribute.type) {
+    case ATTRIBUTE_FLOAT:
+      std::memcpy(out, in, attribute.components * sizeof(float));
+      break;
+    case ATTRIBUTE_HALF:
+      for (int c = 0; c < attribute.components; c++) {
+        uint16_t half = floatToHalf(in[c]);
+        std::memcpy(out + 2 * c, &half, 2);
+      }
+      break;
+    case ATTRIBUTE_SNORM16:
+      for (int c = 0; c < attribute.components; c++) {
+        int16_t snorm = toSnorm16(in[c]);
+        std::memcpy(out + 2 * c, &snorm, 2);
+      }
+      break;
+    case ATTRIBUTE_UNORM16:
+      for (int c = 0; c < attribute.components; c++) {
+        uint16_t unorm = toUnorm16(in[c]);
+        std::memcpy(out + 2 * c, &unorm, 2);
+      }
+      break;
+    case ATTRIBUTE_SNORM_2_10_10_10: {
+      uint32_t packed =
+          toSnorm10(in[0]) | toSnorm10(in[1]) << 10 | toSnorm10(in[2]) << 20;
+      std::memcpy(out, &packed, 4);
+      break;
+    }
+    case ATTRIBUTE_OCTAHEDRAL: {
+      float l1 = std::fabs(in[0]) + std::fabs(in[1]) + std::fabs(in[2]);
+      float x = l1 > 0.0f ? in[0] / l1 : 0.0f;
+      float y = l1 > 0.0f ? in[1] / l1 : 0.0f;
+      if (in[2] < 0.0f) {
+        // fold the lower half over the diagonals
+        float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+      }
+      int16_t encoded[2] = {toSnorm16(x), toSnorm16(y)};
+      std::memcpy(out, encoded, 4);
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+int attributeSize(const VertexAttribute& attribute) {
+  switch (attribute.type) {
+    case ATTRIBUTE_FLOAT:
+      return 4 * attribute.components;
+    case ATTRIBUTE_HALF:
+    case ATTRIBUTE_SNORM16:
+    case ATTRIBUTE_UNORM16:
+      return 2 * attribute.components;
+    case ATTRIBUTE_SNORM_2_10_10_10:
+    case ATTRIBUTE_OCTAHEDRAL:
+      return 4;
+  }
+  return 0;
+}
+
+int VertexFormat::stride() const {
+  return (int)offset(attributes.size());
+}
+
+size_t VertexFormat::offset(size_t i) const {
+  size_t offset = 0;
+  for (size_t a = 0; a < i; a++) {
+    offset = alignUp(offset + attributeSize(attributes[a]), 4);
+  }
+  return offset;
+}
+
+std::vector<unsigned char> packVertices(const VertexFormat& format,
+                                        const float* vertices,
+                                        int n_vertices) {
+  const int stride = format.stride();
+  std::vector<unsigned char> packed((size_t)n_vertices * stride, 0);
+  const float* in = vertices;
+  for (int v = 0; v < n_vertices; v++) {
+    unsigned char* out = packed.data() + (size_t)v * stride;
+    for (size_t a = 0; a < format.attributes.size(); a++) {
+      packAttribute(format.attributes[a], in, out + format.offset(a));
+      in += format.attributes[a].components;
+    }
+  }
+  return packed;
+}
+
+void enableVertexFormat(const VertexFormat& format) {
+  for (const VertexAttribute& attribute : format.attributes) {
+    glEnableVertexAttribArray(attribute.location);
+    glVertexAttribDivisor(attribute.location, format.divisor);
+  }
+}
+
+void pointVertexFormat(const VertexFormat& format, size_t offset) {
+  const GLsizei stride = format.stride();
+  for (size_t a = 0; a < format.attributes.size(); a++) {
+    const VertexAttribute& attribute = format.attributes[a];
+    const void* pointer = (const void*)(offset + format.offset(a));
+    switch (attribute.type) {
+      case ATTRIBUTE_FLOAT:
+        glVertexAttribPointer(attribute.location, attribute.components,
+                              GL_FLOAT, GL_FALSE, stride, pointer);
+        break;
+      case ATTRIBUTE_HALF:
+        glVertexAttribPointer(attribute.location, attribute.components,
+                              GL_HALF_FLOAT, GL_FALSE, stride, pointer);
+        break;
+      case ATTRIBUTE_SNORM16:
+        glVertexAttribPointer(attribute.location, attribute.components,
+                              GL_SHORT, GL_TRUE, stride, pointer);
+        break;
+      case ATTRIBUTE_UNORM16:
+        glVertexAttribPointer(attribute.location, attribute.components,
+                              GL_UNSIGNED_SHORT, GL_TRUE, stride, pointer);
+        break;
+      case ATTRIBUTE_SNORM_2_10_10_10:
+        glVertexAttribPointer(attribute.location, 4, GL_INT_2_10_10_10_REV,
+                              GL_TRUE, stride, pointer);
+        break;
+      case ATTRIBUTE_OCTAHEDRAL:
+        glVertexAttribPointer(attribute.location, 2, GL_SHORT, GL_TRUE,
+                              stride, pointer);
+        break;
+    }
+  }
+}
+
+uint16_t floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, 4);
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t magnitude = bits & 0x7fffffff;
+  if (magnitude > 0x7f800000) {
+    return sign | 0x7e00;  // NaN
+  }
+  int exponent = (int)(magnitude >> 23) - 127 + 15;
+  uint32_t mantissa = magnitude & 0x7fffff;
+  if (exponent >= 31) {
+    return sign | 0x7c00;  // too large: infinity
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return sign;  // rounds to zero
+    }
+    // denormal: shift the implicit one in
+    mantissa |= 0x800000;
+    int shift = 14 - exponent;
+    uint32_t half = mantissa >> shift;
+    if (roundsUp(mantissa, shift, half)) {
+      half++;
+    }
+    return sign | (uint16_t)half;
+  }
+  uint32_t half = (uint32_t)exponent << 10 | mantissa >> 13;
+  // a carry correctly bumps the exponent, or overflows to infinity
+  if (roundsUp(mantissa, 13, half)) {
+    half++;
+  }
+  return sign | (uint16_t)half;
+}
@@ -0,0 +1,70 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <vector>
+
+// How one attribute is stored in the vertex buffer. Every type reaches the
+// shader as floats.
+enum AttributeType {
+  // 32-bit float per component
+  ATTRIBUTE_FLOAT = 0,
+  // 16-bit float per component
+  ATTRIBUTE_HALF = 1,
+  // [-1, 1] as normalized 16-bit signed integers
+  ATTRIBUTE_SNORM16 = 2,
+  // [0, 1] as normalized 16-bit unsigned integers
+  ATTRIBUTE_UNORM16 = 3,
+  // A unit vector in 10 signed normalized bits per component, packed in 32
+  // bits; reaches the shader as a vec4 with w = 0
+  ATTRIBUTE_SNORM_2_10_10_10 = 4,
+  // A unit vector folded onto the octahedron |x| + |y| + |z| = 1, stored as
+  // two snorm16. The shader decodes it:
+  //   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  //   if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+  //   n = normalize(n);
+  ATTRIBUTE_OCTAHEDRAL = 5
+};
+
+struct VertexAttribute {
+  GLuint location;
+  // Float components the attribute is packed from: 3 for the unit vector
+  // types
+  int components;
+  AttributeType type;
+};
+
+// Declarative layout of interleaved vertices: the attributes in buffer
+// order, each starting at a 4-byte aligned offset
+struct VertexFormat {
+  std::vector<VertexAttribute> attributes;
+  // 0 advances per vertex, n once every n instances
+  GLuint divisor = 0;
+
+  // Bytes from one vertex to the next
+  int stride() const;
+  // Byte offset of attributes[i] within a vertex
+  size_t offset(size_t i) const;
+};
+
+// Bytes attribute |attribute| takes, before alignment
+int attributeSize(const VertexAttribute& attribute);
+
+// Packs |n_vertices| vertices given as floats, each attribute's components
+// in order, into |format|.stride() bytes each
+std::vector<unsigned char> packVertices(const VertexFormat& format,
+                                        const float* vertices,
+                                        int n_vertices);
+
+// Enables the format's attributes in the bound VAO and sets their divisor
+void enableVertexFormat(const VertexFormat& format);
+// Points the format's attributes at the buffer bound to GL_ARRAY_BUFFER,
+// the first vertex at byte |offset|
+void pointVertexFormat(const VertexFormat& format, size_t offset);
+
+// IEEE 754 binary16 nearest to |value|, ties to even
+uint16_t floatToHalf(float value);
+
+#endif